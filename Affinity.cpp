@@ -0,0 +1,138 @@
+#include "Affinity.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <algorithm>
+
+using namespace std;
+
+
+bool ThreadPlacement::parse(const std::string &spec) {
+    this->cpus.clear();
+    if (spec == "none") {
+        this->policy = AFFINITY_NONE;
+        return true;
+    }
+    if (spec == "compact" || spec == "scatter") {
+        this->policy = spec == "compact" ? AFFINITY_COMPACT : AFFINITY_SCATTER;
+        this->resolve();
+        return true;
+    }
+
+    this->policy = AFFINITY_LIST;
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t comma = spec.find(',', pos);
+        string item = spec.substr(pos, comma == string::npos ? string::npos : comma - pos);
+        size_t dash = item.find('-');
+        char *end;
+        long first = strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (end == item.c_str() || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        if (dash != string::npos) {
+            last = strtol(item.c_str() + dash + 1, &end, 10);
+            if (last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+        }
+        if (*end != '\0') {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            this->cpus.push_back((int) cpu);
+        }
+        pos = comma == string::npos ? spec.size() : comma + 1;
+    }
+    return !this->cpus.empty();
+}
+
+
+static int read_topology(int cpu, const char *field) {
+    string path = "/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/" + field;
+    ifstream f(path.c_str());
+    int value = -1;
+    f >> value;
+    return value;
+}
+
+struct CpuSlot {
+    int cpu;
+    int package;
+    int core;           // rank of the physical core within its package
+    int smt;            // rank of the hardware thread within its core
+};
+
+// Orders the CPUs this process may run on for the compact or scatter policy.
+void ThreadPlacement::resolve() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+
+    vector<CpuSlot> slots;
+    map< pair<int, int>, int > threads_per_core;
+    map< pair<int, int>, int > core_rank;
+    map< int, int > cores_per_package;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        CpuSlot slot;
+        slot.cpu = cpu;
+        slot.package = max(read_topology(cpu, "physical_package_id"), 0);
+        int core_id = read_topology(cpu, "core_id");
+        pair<int, int> core = make_pair(slot.package, core_id < 0 ? cpu : core_id);
+        if (core_rank.find(core) == core_rank.end()) {
+            core_rank[core] = cores_per_package[slot.package]++;
+        }
+        slot.core = core_rank[core];
+        slot.smt = threads_per_core[core]++;
+        slots.push_back(slot);
+    }
+
+    if (this->policy == AFFINITY_COMPACT) {
+        sort(slots.begin(), slots.end(), [](const CpuSlot &a, const CpuSlot &b) {
+            if (a.package != b.package) return a.package < b.package;
+            if (a.core != b.core) return a.core < b.core;
+            return a.smt < b.smt;
+        });
+    } else {
+        sort(slots.begin(), slots.end(), [](const CpuSlot &a, const CpuSlot &b) {
+            if (a.smt != b.smt) return a.smt < b.smt;
+            if (a.core != b.core) return a.core < b.core;
+            return a.package < b.package;
+        });
+    }
+    for (size_t i = 0; i < slots.size(); i++) {
+        this->cpus.push_back(slots[i].cpu);
+    }
+}
+
+
+int ThreadPlacement::cpu_for(int tid) const {
+    if (this->policy == AFFINITY_NONE || this->cpus.empty()) {
+        return -1;
+    }
+    return this->cpus[tid % this->cpus.size()];
+}
+
+
+void ThreadPlacement::pin_current(int tid) const {
+    int cpu = this->cpu_for(tid);
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        cerr << "could not pin thread " << tid << " to cpu " << cpu << endl;
+    }
+}
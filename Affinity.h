@@ -0,0 +1,34 @@
+#ifndef MULTIQUEUE_AFFINITY_H
+#define MULTIQUEUE_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+enum AffinityPolicy {
+    AFFINITY_NONE,      // leave placement to the OS
+    AFFINITY_COMPACT,   // fill the hardware threads of a core, then the cores of a socket, then the next socket
+    AFFINITY_SCATTER,   // one thread per physical core, alternating sockets, before doubling up on SMT siblings
+    AFFINITY_LIST       // explicit core list, tid i on the i-th entry (wrapping around)
+};
+
+// Worker tid -> CPU mapping. Worker tid always lands on the same CPU, so the
+// per-thread state MultiQueues and the record manager keep for it stays local.
+class ThreadPlacement {
+    public:
+        ThreadPlacement() : policy(AFFINITY_NONE) {}
+        AffinityPolicy policy;
+
+        // "none", "compact", "scatter" or a core list such as "0,2,4-7", with
+        // ids below CPU_SETSIZE
+        bool parse(const std::string &spec);
+        // CPU for worker tid, -1 when unpinned
+        int cpu_for(int tid) const;
+        // pins the calling thread according to cpu_for(tid)
+        void pin_current(int tid) const;
+
+    private:
+        std::vector<int> cpus;      // in placement order
+        void resolve();
+};
+
+#endif //MULTIQUEUE_AFFINITY_H
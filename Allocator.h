@@ -27,6 +27,11 @@ public:
         }
     }
 
+    static void destroy_allocator() {
+        delete mgr;
+        mgr = NULL;
+    }
+
     static Offer* allocate(int tid) {
         mgr_lock.lock();
         Offer* offer = mgr->template allocate<Offer>(tid);
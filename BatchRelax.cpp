@@ -0,0 +1,116 @@
+#include "BatchRelax.h"
+
+#if defined(__x86_64__) && !defined(MQ_64BIT)
+#define BATCH_RELAX_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+bool parse_relax_kernel(const std::string &name, RelaxKernel *kernel) {
+    if (name == "auto") {
+        *kernel = RELAX_AUTO;
+    } else if (name == "scalar") {
+        *kernel = RELAX_SCALAR;
+    } else if (name == "avx2") {
+        *kernel = RELAX_AVX2;
+    } else if (name == "avx512") {
+        *kernel = RELAX_AVX512;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+const char *relax_kernel_name(RelaxKernel kernel) {
+    switch (kernel) {
+        case RELAX_SCALAR:
+            return "scalar";
+        case RELAX_AVX2:
+            return "avx2";
+        case RELAX_AVX512:
+            return "avx512";
+        default:
+            return "auto";
+    }
+}
+
+
+#ifdef BATCH_RELAX_X86
+
+// Weights and keys are at most DIST_INF = 2^31 - 1, so their sum never wraps
+// as an unsigned 32-bit value, and an unsigned min saturates it. Keys are
+// compared signed, both sides being non-negative.
+__attribute__((target("avx2")))
+static uint32_t improving_arcs_avx2(dist_t g, const vertex_t *targets, const int *weights,
+                                    const std::atomic<dist_t> *keys, dist_t *alts) {
+    __m256i index = _mm256_loadu_si256((const __m256i *) targets);
+    __m256i weight = _mm256_loadu_si256((const __m256i *) weights);
+    __m256i alt = _mm256_min_epu32(_mm256_add_epi32(_mm256_set1_epi32(g), weight), _mm256_set1_epi32(DIST_INF));
+    __m256i key = _mm256_i32gather_epi32((const int *) keys, index, sizeof(dist_t));
+    _mm256_storeu_si256((__m256i *) alts, alt);
+    return (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, alt)));
+}
+
+
+__attribute__((target("avx512f")))
+static uint32_t improving_arcs_avx512(dist_t g, const vertex_t *targets, const int *weights,
+                                      const std::atomic<dist_t> *keys, dist_t *alts) {
+    __m512i index = _mm512_loadu_si512((const void *) targets);
+    __m512i weight = _mm512_loadu_si512((const void *) weights);
+    __m512i alt = _mm512_min_epu32(_mm512_add_epi32(_mm512_set1_epi32(g), weight), _mm512_set1_epi32(DIST_INF));
+    __m512i key = _mm512_i32gather_epi32(index, (const void *) keys, sizeof(dist_t));
+    _mm512_storeu_si512((void *) alts, alt);
+    return (uint32_t) _mm512_cmpgt_epi32_mask(key, alt);
+}
+
+#endif
+
+
+bool relax_kernel_supported(RelaxKernel kernel) {
+    switch (kernel) {
+        case RELAX_AUTO:
+        case RELAX_SCALAR:
+            return true;
+#ifdef BATCH_RELAX_X86
+        case RELAX_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case RELAX_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+
+RelaxKernel best_relax_kernel() {
+    if (relax_kernel_supported(RELAX_AVX512)) {
+        return RELAX_AVX512;
+    }
+    if (relax_kernel_supported(RELAX_AVX2)) {
+        return RELAX_AVX2;
+    }
+    return RELAX_SCALAR;
+}
+
+
+ImprovingArcs relax_kernel_function(RelaxKernel kernel) {
+    switch (kernel) {
+#ifdef BATCH_RELAX_X86
+        case RELAX_AVX2:
+            return improving_arcs_avx2;
+        case RELAX_AVX512:
+            return improving_arcs_avx512;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+
+int relax_kernel_width(RelaxKernel kernel) {
+    return kernel == RELAX_AVX512 ? 16 : kernel == RELAX_AVX2 ? 8 : 1;
+}
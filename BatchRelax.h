@@ -0,0 +1,41 @@
+#ifndef MULTIQUEUE_BATCHRELAX_H
+#define MULTIQUEUE_BATCHRELAX_H
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+#include "Graph.h"
+
+#define MAX_RELAX_WIDTH 16
+
+// How the arcs of a popped vertex are screened before relax: one at a time,
+// or 8 (AVX2) or 16 (AVX-512) at once, gathering the targets' offer keys and
+// comparing them with the candidate keys in one step.
+enum RelaxKernel {
+    RELAX_AUTO,         // the widest kernel this CPU and build support
+    RELAX_SCALAR,
+    RELAX_AVX2,
+    RELAX_AVX512
+};
+
+// Parses "auto", "scalar", "avx2" or "avx512". Returns false for anything else.
+bool parse_relax_kernel(const std::string &name, RelaxKernel *kernel);
+const char *relax_kernel_name(RelaxKernel kernel);
+
+// The vector kernels need an x86-64 CPU with the instructions and 32-bit
+// vertex ids and distances; the scalar one is always there.
+bool relax_kernel_supported(RelaxKernel kernel);
+RelaxKernel best_relax_kernel();
+
+// For the arcs of targets[0 .. width) and weights[0 .. width): sets alts[i]
+// to g + weights[i], saturating at DIST_INF, and returns a mask with bit i
+// set if alts[i] is below keys[targets[i]]. The keys are read without
+// ordering, like the first load of relax.
+typedef uint32_t (*ImprovingArcs)(dist_t g, const vertex_t *targets, const int *weights,
+                                  const std::atomic<dist_t> *keys, dist_t *alts);
+
+// The kernel's screen and its width, NULL and 1 for the scalar kernel.
+ImprovingArcs relax_kernel_function(RelaxKernel kernel);
+int relax_kernel_width(RelaxKernel kernel);
+
+#endif //MULTIQUEUE_BATCHRELAX_H
@@ -0,0 +1,602 @@
+#include "ContractionHierarchy.h"
+#include "Parallel.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+// A witness search gives up after settling this many vertices; the shortcut
+// it was checking is then added, which costs query time but never correctness.
+// Priorities only estimate the shortcut count, with a tighter limit.
+#define WITNESS_SETTLE_LIMIT 500
+#define PRIORITY_SETTLE_LIMIT 50
+#define ADJACENCY_LOCKS 4096
+
+namespace {
+
+struct Arc {
+    vertex_t to;
+    dist_t weight;
+};
+
+struct Shortcut {
+    vertex_t u;
+    vertex_t v;
+    dist_t weight;
+};
+
+enum VertexState {
+    REMAINING,
+    CONTRACTING,        // in this round's independent set
+    CONTRACTED
+};
+
+// Local Dijkstra over the remaining graph, reusing one dAryMinHeap whose
+// entries live in a pool owned by the search.
+class WitnessSearch {
+    public:
+        WitnessSearch(vertex_t n) : wanted(n, 0), heap(HEAP_MIN_CAPACITY), dist(n, DIST_INF), used(0) {}
+
+        vector<uint8_t> wanted;     // scratch marks for the caller's targets
+        vector<dist_t> heaviest;    // scratch for the caller
+
+        // distances from x within the remaining vertices other than skip,
+        // exploring no further than limit and stopping once the `targets`
+        // vertices marked in `wanted` are settled
+        void run(const vector< vector<Arc> > &adj, const vector<uint8_t> &state, vertex_t x, vertex_t skip,
+                 dist_t limit, const vector<uint8_t> &wanted, size_t targets, int maxSettled) {
+            for (size_t i = 0; i < touched.size(); i++) {
+                dist[touched[i]] = DIST_INF;
+            }
+            touched.clear();
+            heap.clear();
+            used = 0;
+
+            push(x, 0);
+            int settled = 0;
+            while (!heap.isEmpty() && settled < maxSettled && targets > 0) {
+                Offer *min = heap.extractMin();
+                vertex_t u = min->vertex;
+                dist_t d = min->dist;
+                if (d > dist[u]) {
+                    continue;
+                }
+                if (d > limit) {
+                    break;
+                }
+                settled++;
+                if (wanted[u]) {
+                    targets--;
+                }
+                for (size_t i = 0; i < adj[u].size(); i++) {
+                    vertex_t v = adj[u][i].to;
+                    dist_t alt = add_dists(d, adj[u][i].weight);
+                    if (v != skip && state[v] == REMAINING && alt < dist[v] && alt <= limit) {
+                        push(v, alt);
+                    }
+                }
+            }
+        }
+
+        dist_t distance(vertex_t v) const { return dist[v]; }
+
+    private:
+        dAryMinHeap heap;
+        vector<dist_t> dist;
+        vector<vertex_t> touched;
+        deque<Offer> pool;
+        size_t used;
+
+        void push(vertex_t v, dist_t d) {
+            if (dist[v] == DIST_INF) {
+                touched.push_back(v);
+            }
+            dist[v] = d;
+            if (used == pool.size()) {
+                pool.push_back(Offer());
+            }
+            Offer *offer = &pool[used++];
+            offer->vertex = v;
+            offer->dist = d;
+            heap.insert(offer);
+        }
+};
+
+}
+
+
+// Remaining neighbors of v, one arc each (the lightest), sorted by id.
+static void remaining_neighbors(const vector< vector<Arc> > &adj, const vector<uint8_t> &state, vertex_t v,
+                                vector<Arc> &out) {
+    out.clear();
+    for (size_t i = 0; i < adj[v].size(); i++) {
+        if (state[adj[v][i].to] == REMAINING) {
+            out.push_back(adj[v][i]);
+        }
+    }
+    sort(out.begin(), out.end(), [](const Arc &a, const Arc &b) {
+        return a.to < b.to || (a.to == b.to && a.weight < b.weight);
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (kept == 0 || out[kept - 1].to != out[i].to) {
+            out[kept++] = out[i];
+        }
+    }
+    out.resize(kept);
+}
+
+
+// The shortcuts contracting v would need between its remaining neighbors.
+static void find_shortcuts(const vector< vector<Arc> > &adj, const vector<uint8_t> &state, vertex_t v,
+                           const vector<Arc> &neighbors, WitnessSearch &witness, int maxSettled,
+                           vector<Shortcut> &out) {
+    out.clear();
+    // heaviest[i]: the heaviest arc to a neighbor after the i-th, the only
+    // ones the search from the i-th neighbor has to reach
+    size_t k = neighbors.size();
+    vector<dist_t> &heaviest = witness.heaviest;
+    heaviest.resize(k + 1);
+    heaviest[k] = 0;
+    for (size_t j = k; j > 0; j--) {
+        heaviest[j - 1] = max(heaviest[j], neighbors[j - 1].weight);
+        witness.wanted[neighbors[j - 1].to] = 1;
+    }
+    for (size_t i = 0; i + 1 < k; i++) {
+        witness.wanted[neighbors[i].to] = 0;
+        witness.run(adj, state, neighbors[i].to, v, add_dists(neighbors[i].weight, heaviest[i + 1]), witness.wanted,
+                    k - i - 1, maxSettled);
+        for (size_t j = i + 1; j < neighbors.size(); j++) {
+            // a path that saturates is no path: no shortcut stands for it
+            dist_t via = add_dists(neighbors[i].weight, neighbors[j].weight);
+            if (via < DIST_INF && witness.distance(neighbors[j].to) > via) {
+                Shortcut s = {neighbors[i].to, neighbors[j].to, via};
+                out.push_back(s);
+            }
+        }
+    }
+    if (!neighbors.empty()) {
+        witness.wanted[neighbors.back().to] = 0;
+    }
+}
+
+
+// Ties between equal priorities are broken by a hash of the id, so that
+// neighboring vertices of a regular region do not all wait on each other.
+static inline bool contract_before(int pu, vertex_t u, int pv, vertex_t v) {
+    uint32_t hu = (uint32_t) ((uint64_t) u * 2654435761u >> 7);
+    uint32_t hv = (uint32_t) ((uint64_t) v * 2654435761u >> 7);
+    return pu < pv || (pu == pv && (hu < hv || (hu == hv && u < v)));
+}
+
+
+void ContractionHierarchy::build(const Graph *G, int numOfThreads) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vertex_t n = G->num_vertices;
+    int p = numOfThreads;
+
+    vector< vector<Arc> > adj(n);
+    for (vertex_t v = 0; v < n; v++) {
+        adj[v].reserve(G->degree(v));
+        for (edge_t e = G->offsets[v]; e < G->offsets[v + 1]; e++) {
+            if (G->weights[e] != DELETED_WEIGHT) {
+                Arc arc = {G->targets[e], G->weights[e]};
+                adj[v].push_back(arc);
+            }
+        }
+    }
+    vector<uint8_t> state(n, REMAINING);
+    vector<int> priority(n);
+    vector< atomic<int> > deleted(n);
+    vector< vector<Arc> > upward(n);
+    vector<WitnessSearch*> witnesses;
+    for (int t = 0; t < p; t++) {
+        witnesses.push_back(new WitnessSearch(n));
+    }
+    vector< vector<Arc> > scratch(p);
+    vector< vector<Shortcut> > found(p);
+
+    // edge difference: shortcuts added minus arcs removed, plus the number of
+    // contracted neighbors to spread contraction evenly over the graph
+    auto update_priority = [&](int t, vertex_t v) {
+        remaining_neighbors(adj, state, v, scratch[t]);
+        find_shortcuts(adj, state, v, scratch[t], *witnesses[t], PRIORITY_SETTLE_LIMIT, found[t]);
+        priority[v] = (int) found[t].size() - (int) scratch[t].size() + deleted[v];
+    };
+
+    vector<vertex_t> remaining(n);
+    for (vertex_t v = 0; v < n; v++) {
+        remaining[v] = v;
+        deleted[v] = 0;
+    }
+    for_each_index(n, p, [&](int t, size_t v) {
+        update_priority(t, (vertex_t) v);
+    });
+
+    vector<mutex> locks(ADJACENCY_LOCKS);
+    vector<uint8_t> touched(n, 0);
+    vector< vector<vertex_t> > picked(p);
+    edge_t shortcuts = 0;
+    int rounds = 0;
+
+    while (!remaining.empty()) {
+        // independent set: strict local minima of the priority
+        for_each_slice(remaining.size(), p, [&](int t, size_t first, size_t last) {
+            picked[t].clear();
+            for (size_t i = first; i < last; i++) {
+                vertex_t v = remaining[i];
+                bool minimum = true;
+                for (size_t k = 0; k < adj[v].size() && minimum; k++) {
+                    vertex_t u = adj[v][k].to;
+                    minimum = state[u] != REMAINING || contract_before(priority[v], v, priority[u], u);
+                }
+                if (minimum) {
+                    picked[t].push_back(v);
+                }
+            }
+        });
+        vector<vertex_t> set;
+        for (int t = 0; t < p; t++) {
+            set.insert(set.end(), picked[t].begin(), picked[t].end());
+        }
+        for (size_t i = 0; i < set.size(); i++) {
+            state[set[i]] = CONTRACTING;
+        }
+
+        // witness searches see neither this round's vertices nor the shortcuts
+        // around them, so they may only add redundant shortcuts, never miss one
+        vector< vector<Shortcut> > added(set.size());
+        for_each_index(set.size(), p, [&](int t, size_t i) {
+            vertex_t v = set[i];
+            remaining_neighbors(adj, state, v, upward[v]);
+            find_shortcuts(adj, state, v, upward[v], *witnesses[t], WITNESS_SETTLE_LIMIT, added[i]);
+        });
+        for (size_t i = 0; i < set.size(); i++) {
+            state[set[i]] = CONTRACTED;
+            shortcuts += added[i].size();
+        }
+
+        for_each_index(set.size(), p, [&](int, size_t i) {
+            for (size_t k = 0; k < added[i].size(); k++) {
+                const Shortcut &s = added[i][k];
+                vertex_t ends[2] = {s.u, s.v};
+                for (int e = 0; e < 2; e++) {
+                    vertex_t from = ends[e], to = ends[1 - e];
+                    lock_guard<mutex> guard(locks[from % ADJACENCY_LOCKS]);
+                    bool present = false;
+                    for (size_t a = 0; a < adj[from].size() && !present; a++) {
+                        if (adj[from][a].to == to) {
+                            adj[from][a].weight = min(adj[from][a].weight, s.weight);
+                            present = true;
+                        }
+                    }
+                    if (!present) {
+                        Arc arc = {to, s.weight};
+                        adj[from].push_back(arc);
+                    }
+                }
+            }
+        });
+
+        // neighbors of the set lose their contracted arcs and are re-prioritized
+        vector<vertex_t> affected;
+        for (size_t i = 0; i < set.size(); i++) {
+            const vector<Arc> &up = upward[set[i]];
+            for (size_t k = 0; k < up.size(); k++) {
+                deleted[up[k].to]++;
+                if (!touched[up[k].to]) {
+                    touched[up[k].to] = 1;
+                    affected.push_back(up[k].to);
+                }
+            }
+            vector<Arc>().swap(adj[set[i]]);
+        }
+        for_each_index(affected.size(), p, [&](int, size_t i) {
+            vertex_t u = affected[i];
+            touched[u] = 0;
+            vector<Arc> &list = adj[u];
+            size_t kept = 0;
+            for (size_t k = 0; k < list.size(); k++) {
+                if (state[list[k].to] == REMAINING) {
+                    list[kept++] = list[k];
+                }
+            }
+            list.resize(kept);
+        });
+        for_each_index(affected.size(), p, [&](int t, size_t i) {
+            update_priority(t, affected[i]);
+        });
+
+        size_t kept = 0;
+        for (size_t i = 0; i < remaining.size(); i++) {
+            if (state[remaining[i]] == REMAINING) {
+                remaining[kept++] = remaining[i];
+            }
+        }
+        remaining.resize(kept);
+        rounds++;
+    }
+
+    for (int t = 0; t < p; t++) {
+        delete witnesses[t];
+    }
+
+    this->num_vertices = n;
+    this->offsets.resize((size_t) n + 1);
+    this->offsets[0] = 0;
+    for (vertex_t v = 0; v < n; v++) {
+        this->offsets[v + 1] = this->offsets[v] + upward[v].size();
+    }
+    this->targets.resize(this->offsets[n]);
+    this->weights.resize(this->offsets[n]);
+    for (vertex_t v = 0; v < n; v++) {
+        edge_t out = this->offsets[v];
+        for (size_t k = 0; k < upward[v].size(); k++, out++) {
+            this->targets[out] = upward[v][k].to;
+            this->weights[out] = upward[v][k].weight;
+        }
+    }
+
+    cout << "contracted " << n << " vertices in " << rounds << " rounds, " << shortcuts << " shortcuts, "
+         << this->offsets[n] << " upward arcs in "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+}
+
+
+static inline size_t align8(size_t bytes) {
+    return (bytes + 7) & ~(size_t) 7;
+}
+
+
+bool ContractionHierarchy::save(const std::string &path, const Graph *G) const {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    // the upward graph in the file's vertex order
+    vertex_t n = this->num_vertices;
+    vector<vertex_t> file_id(n);
+    for (vertex_t i = 0; i < n; i++) {
+        file_id[G->internal_id(i)] = i;
+    }
+    GraphArray<edge_t> offsets;
+    GraphArray<vertex_t> targets;
+    GraphArray<dist_t> weights;
+    offsets.resize((size_t) n + 1);
+    targets.resize(this->targets.size());
+    weights.resize(this->weights.size());
+    offsets[0] = 0;
+    for (vertex_t i = 0; i < n; i++) {
+        vertex_t v = G->internal_id(i);
+        edge_t out = offsets[i];
+        for (edge_t e = this->offsets[v]; e < this->offsets[v + 1]; e++, out++) {
+            targets[out] = file_id[this->targets[e]];
+            weights[out] = this->weights[e];
+        }
+        offsets[i + 1] = out;
+    }
+
+    HierarchyFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HIERARCHY_FILE_MAGIC, sizeof(HIERARCHY_FILE_MAGIC));
+    header.version = HIERARCHY_FILE_VERSION;
+    header.num_vertices = n;
+    header.num_arcs = targets.size();
+    header.offset_bytes = sizeof(edge_t);
+    header.vertex_bytes = sizeof(vertex_t);
+    header.dist_bytes = sizeof(dist_t);
+
+    static const char padding[8] = {0};
+    size_t m = targets.size();
+    size_t offsets_bytes = ((size_t) n + 1) * sizeof(edge_t);
+    size_t targets_bytes = m * sizeof(vertex_t);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(padding, 1, align8(sizeof(header)) - sizeof(header), f) == align8(sizeof(header)) - sizeof(header) &&
+              fwrite(offsets.data(), 1, offsets_bytes, f) == offsets_bytes &&
+              fwrite(padding, 1, align8(offsets_bytes) - offsets_bytes, f) == align8(offsets_bytes) - offsets_bytes &&
+              fwrite(targets.data(), 1, targets_bytes, f) == targets_bytes &&
+              fwrite(padding, 1, align8(targets_bytes) - targets_bytes, f) == align8(targets_bytes) - targets_bytes &&
+              fwrite(weights.data(), sizeof(dist_t), m, f) == m;
+    return fclose(f) == 0 && ok;
+}
+
+
+bool ContractionHierarchy::load(const std::string &path, const Graph *G) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    HierarchyFileHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, HIERARCHY_FILE_MAGIC, sizeof(HIERARCHY_FILE_MAGIC)) != 0 ||
+        header.version != HIERARCHY_FILE_VERSION || header.offset_bytes != sizeof(edge_t) ||
+        header.vertex_bytes != sizeof(vertex_t) || header.dist_bytes != sizeof(dist_t) ||
+        header.num_vertices != G->num_vertices) {
+        cerr << "Hierarchy file " << path << " does not match this graph and build" << endl;
+        fclose(f);
+        return false;
+    }
+
+    vertex_t n = G->num_vertices;
+    size_t m = header.num_arcs;
+    GraphArray<edge_t> offsets;
+    GraphArray<vertex_t> targets;
+    GraphArray<dist_t> weights;
+    offsets.resize((size_t) n + 1);
+    targets.resize(m);
+    weights.resize(m);
+    size_t offsets_bytes = ((size_t) n + 1) * sizeof(edge_t);
+    size_t targets_bytes = m * sizeof(vertex_t);
+    bool ok = fseek(f, align8(sizeof(header)), SEEK_SET) == 0 &&
+              fread(offsets.data(), 1, offsets_bytes, f) == offsets_bytes &&
+              fseek(f, align8(offsets_bytes) - offsets_bytes, SEEK_CUR) == 0 &&
+              fread(targets.data(), 1, targets_bytes, f) == targets_bytes &&
+              fseek(f, align8(targets_bytes) - targets_bytes, SEEK_CUR) == 0 &&
+              fread(weights.data(), sizeof(dist_t), m, f) == m &&
+              offsets[n] == m;
+    fclose(f);
+    if (!ok) {
+        return false;
+    }
+
+    // back from the file's vertex order to G's
+    this->num_vertices = n;
+    this->offsets.resize((size_t) n + 1);
+    this->targets.resize(m);
+    this->weights.resize(m);
+    this->offsets[0] = 0;
+    vector<vertex_t> file_id(n);
+    for (vertex_t i = 0; i < n; i++) {
+        file_id[G->internal_id(i)] = i;
+    }
+    for (vertex_t v = 0; v < n; v++) {
+        vertex_t i = file_id[v];
+        edge_t out = this->offsets[v];
+        for (edge_t e = offsets[i]; e < offsets[i + 1]; e++, out++) {
+            if (targets[e] >= n) {
+                return false;
+            }
+            this->targets[out] = G->internal_id(targets[e]);
+            this->weights[out] = weights[e];
+        }
+        this->offsets[v + 1] = out;
+    }
+    return true;
+}
+
+
+HierarchyQuery::HierarchyQuery(const ContractionHierarchy *ch) {
+    this->ch = ch;
+    this->used = 0;
+    for (int d = 0; d < 2; d++) {
+        this->dist[d].assign(ch->num_vertices, DIST_INF);
+        this->heaps[d] = new dAryMinHeap(HEAP_MIN_CAPACITY);
+    }
+}
+
+
+HierarchyQuery::~HierarchyQuery() {
+    delete this->heaps[0];
+    delete this->heaps[1];
+}
+
+
+void HierarchyQuery::push(int direction, vertex_t v, dist_t d) {
+    if (this->dist[0][v] == DIST_INF && this->dist[1][v] == DIST_INF) {
+        this->touched.push_back(v);
+    }
+    this->dist[direction][v] = d;
+    if (this->used == this->pool.size()) {
+        this->pool.push_back(Offer());
+    }
+    Offer *offer = &this->pool[this->used++];
+    offer->vertex = v;
+    offer->dist = d;
+    this->heaps[direction]->insert(offer);
+}
+
+
+dist_t HierarchyQuery::distance(vertex_t s, vertex_t t) {
+    for (size_t i = 0; i < this->touched.size(); i++) {
+        this->dist[0][this->touched[i]] = DIST_INF;
+        this->dist[1][this->touched[i]] = DIST_INF;
+    }
+    this->touched.clear();
+    this->heaps[0]->clear();
+    this->heaps[1]->clear();
+    this->used = 0;
+
+    this->push(0, s, 0);
+    this->push(1, t, 0);
+    dist_t best = s == t ? 0 : DIST_INF;
+
+    // a side stops once its smallest key reaches the best meeting found:
+    // every vertex it could still settle lies on no shorter path
+    int dir = 0;
+    while (true) {
+        bool live[2];
+        for (int d = 0; d < 2; d++) {
+            live[d] = !this->heaps[d]->isEmpty() && this->heaps[d]->minKey() < best;
+        }
+        if (!live[0] && !live[1]) {
+            break;
+        }
+        if (!live[dir]) {
+            dir = 1 - dir;
+        }
+
+        Offer *min = this->heaps[dir]->extractMin();
+        vertex_t v = min->vertex;
+        dist_t d = min->dist;
+        if (d > this->dist[dir][v]) {
+            dir = 1 - dir;
+            continue;
+        }
+        dist_t other = this->dist[1 - dir][v];
+        if (add_dists(d, other) < best) {
+            best = add_dists(d, other);
+        }
+        // stall-on-demand: arcs are symmetric, so an upward arc of v is also
+        // an arc into v from a higher vertex; if that one reaches v more
+        // cheaply, d is not v's distance and v need not be expanded
+        bool stalled = false;
+        for (edge_t e = this->ch->offsets[v]; e < this->ch->offsets[v + 1] && !stalled; e++) {
+            dist_t above = this->dist[dir][this->ch->targets[e]];
+            stalled = add_dists(above, this->ch->weights[e]) < d;
+        }
+        if (stalled) {
+            dir = 1 - dir;
+            continue;
+        }
+        for (edge_t e = this->ch->offsets[v]; e < this->ch->offsets[v + 1]; e++) {
+            vertex_t u = this->ch->targets[e];
+            dist_t alt = add_dists(d, this->ch->weights[e]);
+            if (alt < this->dist[dir][u]) {
+                this->push(dir, u, alt);
+            }
+        }
+        dir = 1 - dir;
+    }
+    return best;
+}
+
+
+void hierarchy_queries(const Graph *G, const ContractionHierarchy *ch, const std::vector<Query> &queries, int p,
+                       const std::string &outDir) {
+
+    vector<HierarchyQuery*> engines;
+    for (int t = 0; t < p; t++) {
+        engines.push_back(new HierarchyQuery(ch));
+    }
+    vector<dist_t> answers(queries.size(), DIST_INF);
+    atomic<size_t> failed(0);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for_each_index(queries.size(), p, [&](int t, size_t i) {
+        vertex_t s, target;
+        if (queries[i].target == NO_TARGET || !G->from_file_id(queries[i].source, &s) ||
+            !G->from_file_id(queries[i].target, &target)) {
+            failed++;
+            return;
+        }
+        answers[i] = engines[t]->distance(s, target);
+    }, 16);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (failed) {
+        cerr << "skipped " << failed << " queries with out-of-range vertices or without a target" << endl;
+    }
+    size_t answered = queries.size() - failed;
+    cout << "answered " << answered << " queries in " << seconds << " s (" << answered / seconds << " queries/s, "
+         << seconds * 1e6 * p / max(answered, (size_t) 1) << " us per query per thread, " << p << " threads)" << endl;
+
+    if (!outDir.empty()) {
+        write_pairs(queries, answers, outDir + "/pairs.txt");
+    }
+    for (int t = 0; t < p; t++) {
+        delete engines[t];
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef MULTIQUEUE_CONTRACTIONHIERARCHY_H
+#define MULTIQUEUE_CONTRACTIONHIERARCHY_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include "Graph.h"
+#include "dAryMinHeap.h"
+#include "Distances.h"
+
+#define HIERARCHY_FILE_MAGIC "MQHIER"
+#define HIERARCHY_FILE_VERSION 1
+
+// On-disk layout of a contraction hierarchy: this header, then the upward
+// graph as offsets[num_vertices + 1], targets[num_arcs] and weights[num_arcs],
+// each section starting on an 8-byte boundary, vertices in the graph file's
+// order and with the widths recorded below.
+struct HierarchyFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;             // reserved, 0
+    uint64_t num_vertices;
+    uint64_t num_arcs;
+    uint32_t offset_bytes;      // sizeof(edge_t)
+    uint32_t vertex_bytes;      // sizeof(vertex_t)
+    uint32_t dist_bytes;        // sizeof(dist_t)
+    uint32_t reserved;
+};
+
+// Contraction hierarchy of an undirected graph. Vertices are contracted in
+// rounds: each round takes the vertices whose edge-difference priority is a
+// strict local minimum among their remaining neighbors (an independent set)
+// and contracts them in parallel, adding a shortcut between two neighbors
+// unless a bounded witness search finds a path at most as short without the
+// contracted vertex. Only the upward graph is kept: for every vertex, its
+// arcs, original or shortcut, to the neighbors contracted after it.
+class ContractionHierarchy {
+    public:
+        ContractionHierarchy() : num_vertices(0) {}
+        vertex_t num_vertices;
+        GraphArray<edge_t> offsets;
+        GraphArray<vertex_t> targets;
+        GraphArray<dist_t> weights;
+
+        void build(const Graph *G, int numOfThreads);
+
+        // Both return false on I/O failure or, when loading, a hierarchy made
+        // for a different graph or build.
+        bool save(const std::string &path, const Graph *G) const;
+        bool load(const std::string &path, const Graph *G);
+};
+
+// Point-to-point queries on a hierarchy: Dijkstra upwards from both ends,
+// meeting at the highest vertex of a shortest path. One object per thread;
+// per-vertex state is reset only where the previous query touched it.
+class HierarchyQuery {
+    public:
+        HierarchyQuery(const ContractionHierarchy *ch);
+        ~HierarchyQuery();
+
+        // DIST_INF if there is no s - t path
+        dist_t distance(vertex_t s, vertex_t t);
+
+    private:
+        const ContractionHierarchy *ch;
+        std::vector<dist_t> dist[2];
+        std::vector<vertex_t> touched;
+        dAryMinHeap *heaps[2];
+        std::deque<Offer> pool;         // heap entries, reused across queries
+        size_t used;
+        void push(int direction, vertex_t v, dist_t d);
+};
+
+// Answers every point-to-point query (ids as written in the input file) on p
+// threads and reports the throughput. With a non-empty outDir the answers go
+// to outDir/pairs.txt.
+void hierarchy_queries(const Graph *G, const ContractionHierarchy *ch, const std::vector<Query> &queries, int p,
+                       const std::string &outDir);
+
+#endif //MULTIQUEUE_CONTRACTIONHIERARCHY_H
@@ -0,0 +1,91 @@
+#include "Counters.h"
+#include <new>
+#include <stdlib.h>
+
+using namespace std;
+
+
+const char *work_counter_name(WorkCounter counter) {
+    switch (counter) {
+        case COUNT_POPS:
+            return "pops";
+        case COUNT_STALE_POPS:
+            return "stale_pops";
+        case COUNT_REEXPLORATIONS:
+            return "reexplorations";
+        case COUNT_RELAXATIONS:
+            return "relaxations";
+        case COUNT_FAILED_RELAXATIONS:
+            return "failed_relaxations";
+        case COUNT_INSERTS:
+            return "inserts";
+        default:
+            return "unknown";
+    }
+}
+
+
+WorkCounters::WorkCounters(int numOfThreads) {
+    void *memory;
+    if (posix_memalign(&memory, CACHE_LINE, sizeof(Slot) * numOfThreads) != 0) {
+        throw bad_alloc();
+    }
+    this->slots = (Slot *) memory;
+    this->numOfThreads = numOfThreads;
+    for (int t = 0; t < numOfThreads; t++) {
+        new (&this->slots[t]) Slot();
+    }
+}
+
+
+WorkCounters::~WorkCounters() {
+    free(this->slots);
+}
+
+
+WorkCounts WorkCounters::total() const {
+    WorkCounts sum;
+    for (int t = 0; t < this->numOfThreads; t++) {
+        sum.add(this->slots[t].counts);
+    }
+    return sum;
+}
+
+
+bool parse_stats_format(const string &name, StatsFormat *format) {
+    if (name == "none") {
+        *format = STATS_NONE;
+    } else if (name == "summary") {
+        *format = STATS_SUMMARY;
+    } else if (name == "json") {
+        *format = STATS_JSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+static double ratio(uint64_t part, uint64_t whole) {
+    return whole ? (double) part / whole : 0;
+}
+
+
+void print_work_counts(const WorkCounts &counts, int c, int p, StatsFormat format, ostream &out) {
+    const uint64_t *n = counts.count;
+    if (format == STATS_JSON) {
+        out << "{\"c\": " << c << ", \"p\": " << p << ", \"queries\": " << counts.queries;
+        for (int i = 0; i < NUM_WORK_COUNTERS; i++) {
+            out << ", \"" << work_counter_name((WorkCounter) i) << "\": " << n[i];
+        }
+        out << "}" << endl;
+    } else if (format == STATS_SUMMARY) {
+        uint64_t expanded = n[COUNT_POPS] - n[COUNT_STALE_POPS];
+        out << "work (c = " << c << ", p = " << p << ", " << counts.queries << " queries): "
+            << n[COUNT_POPS] << " pops, " << n[COUNT_STALE_POPS] << " stale ("
+            << 100 * ratio(n[COUNT_STALE_POPS], n[COUNT_POPS]) << "%), "
+            << n[COUNT_REEXPLORATIONS] << " re-explorations (" << 100 * ratio(n[COUNT_REEXPLORATIONS], expanded)
+            << "% of expansions), " << n[COUNT_RELAXATIONS] << " relaxations, " << n[COUNT_FAILED_RELAXATIONS]
+            << " failed, " << n[COUNT_INSERTS] << " inserts" << endl;
+    }
+}
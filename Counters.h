@@ -0,0 +1,72 @@
+#ifndef MULTIQUEUE_COUNTERS_H
+#define MULTIQUEUE_COUNTERS_H
+
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+#define CACHE_LINE 64
+
+// What the relaxed ordering of MultiQueues costs: offers popped after their
+// vertex was already settled at least as cheaply, and vertices expanded again
+// after a later pop found them a shorter distance.
+enum WorkCounter {
+    COUNT_POPS,                 // offers taken from the queue
+    COUNT_STALE_POPS,           // ... whose vertex was already settled as cheaply
+    COUNT_REEXPLORATIONS,       // ... that expanded an already settled vertex again
+    COUNT_RELAXATIONS,          // edges that lowered their target's offer key
+    COUNT_FAILED_RELAXATIONS,   // edges that did not
+    COUNT_INSERTS,              // offers queued
+    NUM_WORK_COUNTERS
+};
+
+const char *work_counter_name(WorkCounter counter);
+
+struct WorkCounts {
+    uint64_t count[NUM_WORK_COUNTERS];
+    uint64_t queries;
+
+    WorkCounts() : queries(0) {
+        for (int i = 0; i < NUM_WORK_COUNTERS; i++) {
+            count[i] = 0;
+        }
+    }
+    void add(const WorkCounts &other) {
+        for (int i = 0; i < NUM_WORK_COUNTERS; i++) {
+            count[i] += other.count[i];
+        }
+        queries += other.queries;
+    }
+};
+
+// One cache line aligned slot per thread, so threads adding their counts do
+// not share lines; total() merges them.
+class WorkCounters {
+    public:
+        WorkCounters(int numOfThreads);
+        ~WorkCounters();
+        WorkCounts &slot(int t) { return slots[t].counts; }
+        WorkCounts total() const;
+
+    private:
+        struct Slot {
+            WorkCounts counts;
+            char padding[CACHE_LINE - sizeof(WorkCounts) % CACHE_LINE];
+        };
+        Slot *slots;
+        int numOfThreads;
+};
+
+enum StatsFormat {
+    STATS_NONE,
+    STATS_SUMMARY,
+    STATS_JSON
+};
+
+bool parse_stats_format(const std::string &name, StatsFormat *format);
+
+// Prints the counts with the queue parameters they were measured with: a
+// readable summary, or one JSON object per line.
+void print_work_counts(const WorkCounts &counts, int c, int p, StatsFormat format, std::ostream &out);
+
+#endif //MULTIQUEUE_COUNTERS_H
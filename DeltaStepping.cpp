@@ -0,0 +1,246 @@
+#include "DeltaStepping.h"
+#include "Distances.h"
+#include <pthread.h>
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+
+// Vertices are kept in bucket floor(dist / delta). Each thread owns a ring of
+// buckets large enough to cover one heaviest edge past the current bucket, so
+// bucket b lives in slot b % numBuckets. A bucket is processed in phases: the
+// frontier (its vertices, from every thread) relaxes its light edges
+// (weight <= delta), which may refill the same bucket; once it stays empty,
+// every vertex settled in it relaxes its heavy edges, which only reach later
+// buckets.
+class DeltaState {
+public:
+    Graph *G;
+    dist_t delta;
+    int p;
+    size_t numBuckets;
+    const ThreadPlacement *placement;
+
+    atomic<dist_t> *distances;
+    atomic<dist_t> *expanded;       // distance each vertex last relaxed its light edges at
+    vector< vector< vector<vertex_t> > > buckets;   // [thread][slot]
+    vector< vector<vertex_t> > frontiers;           // [thread], this phase's share of the bucket
+    vector< vector<vertex_t> > settled;             // [thread], vertices waiting for their heavy edges
+    vector<vertex_t> frontier;
+    atomic<size_t> next;            // next frontier chunk to hand out
+    atomic<size_t> pending;         // non-empty current-bucket rings after a light phase
+    atomic<dist_t> nextBucket;
+    dist_t current;
+    pthread_barrier_t barrier;
+};
+
+class DeltaThreadInput {
+public:
+    DeltaState *state;
+    int tid;
+
+    DeltaThreadInput(DeltaState *state, int tid) {
+        this->state = state;
+        this->tid = tid;
+    }
+};
+
+#define FRONTIER_CHUNK 256
+#define MAX_DELTA_BUCKETS (1 << 16)     // ring slots per thread; narrower deltas are widened to fit
+
+
+static inline void relax_edges(DeltaState *s, int tid, vertex_t v, dist_t d, bool light) {
+    const edge_t *offsets = s->G->offsets.data();
+    const vertex_t *targets = s->G->targets.data();
+    const int *weights = s->G->weights.data();
+    vector< vector<vertex_t> > &buckets = s->buckets[tid];
+
+    for (edge_t e = offsets[v]; e < offsets[v + 1]; e++) {
+        if ((weights[e] <= s->delta) != light) {
+            continue;
+        }
+        dist_t alt = add_dist(d, weights[e]);
+        vertex_t u = targets[e];
+        if (alt < DIST_INF && atomic_min(s->distances[u], alt)) {
+            buckets[(alt / s->delta) % s->numBuckets].push_back(u);
+        }
+    }
+}
+
+
+void *delta_stepping_worker(void *void_input) {
+    DeltaThreadInput *input = (DeltaThreadInput *) void_input;
+    DeltaState *s = input->state;
+    int tid = input->tid;
+
+    if (s->placement) {
+        s->placement->pin_current(tid);
+    }
+
+    while (true) {
+        dist_t b = s->current;
+        size_t slot = b % s->numBuckets;
+
+        // light phases until no thread has anything left in bucket b
+        while (true) {
+            // take this thread's share of the bucket; entries whose vertex has
+            // since moved to an earlier distance, or was already expanded at
+            // its current one, are stale. A vertex goes on the heavy pass's
+            // list on its first expansion in bucket b only: distances only
+            // drop, so an earlier one in b left expanded[v] in b
+            vector<vertex_t> &mine = s->frontiers[tid];
+            mine.clear();
+            vector<vertex_t> &bucket = s->buckets[tid][slot];
+            for (size_t i = 0; i < bucket.size(); i++) {
+                vertex_t v = bucket[i];
+                dist_t d = s->distances[v].load(memory_order_relaxed);
+                if (d / s->delta != b) {
+                    continue;
+                }
+                dist_t before = s->expanded[v].exchange(d);
+                if (before != d) {
+                    mine.push_back(v);
+                    if (before / s->delta != b) {
+                        s->settled[tid].push_back(v);
+                    }
+                }
+            }
+            bucket.clear();
+            pthread_barrier_wait(&s->barrier);
+
+            if (tid == 0) {
+                s->frontier.clear();
+                for (int t = 0; t < s->p; t++) {
+                    s->frontier.insert(s->frontier.end(), s->frontiers[t].begin(), s->frontiers[t].end());
+                }
+                s->next = 0;
+                s->pending = 0;
+            }
+            pthread_barrier_wait(&s->barrier);
+
+            size_t size = s->frontier.size();
+            for (size_t start = s->next.fetch_add(FRONTIER_CHUNK); start < size; start = s->next.fetch_add(FRONTIER_CHUNK)) {
+                size_t end = min(start + FRONTIER_CHUNK, size);
+                for (size_t i = start; i < end; i++) {
+                    vertex_t v = s->frontier[i];
+                    relax_edges(s, tid, v, s->distances[v].load(memory_order_relaxed), true);
+                }
+            }
+            if (!s->buckets[tid][slot].empty()) {
+                s->pending++;
+            }
+            pthread_barrier_wait(&s->barrier);
+            if (s->pending == 0) {
+                break;
+            }
+        }
+
+        // heavy edges of everything settled in bucket b, once per vertex
+        vector<vertex_t> &settled = s->settled[tid];
+        for (size_t i = 0; i < settled.size(); i++) {
+            vertex_t v = settled[i];
+            dist_t d = s->distances[v].load(memory_order_relaxed);
+            if (d / s->delta == b) {
+                relax_edges(s, tid, v, d, false);
+            }
+        }
+        settled.clear();
+        if (tid == 0) {
+            s->nextBucket = DIST_INF;
+        }
+        pthread_barrier_wait(&s->barrier);
+
+        // the earliest non-empty bucket in any ring is processed next
+        for (size_t k = 1; k < s->numBuckets; k++) {
+            if (!s->buckets[tid][(slot + k) % s->numBuckets].empty()) {
+                atomic_min(s->nextBucket, b + k);
+                break;
+            }
+        }
+        pthread_barrier_wait(&s->barrier);
+        if (s->nextBucket == DIST_INF) {
+            return NULL;
+        }
+        pthread_barrier_wait(&s->barrier);
+        if (tid == 0) {
+            s->current = s->nextBucket;
+        }
+        pthread_barrier_wait(&s->barrier);
+    }
+}
+
+
+dist_t choose_delta(const Graph *G) {
+    int max_weight = 1;
+    for (edge_t e = 0; e < G->num_edges(); e++) {
+        max_weight = max(max_weight, G->weights[e]);
+    }
+    double avg_degree = G->num_vertices ? (double) G->num_edges() / G->num_vertices : 1;
+    dist_t delta = (dist_t) (max_weight / max(avg_degree, 1.0));
+    return max(delta, (dist_t) 1);
+}
+
+
+void delta_stepping_shortest_path(Graph *G, dist_t delta, int p, const ThreadPlacement *placement,
+                                  const OutputOptions &output) {
+    DeltaState state;
+    state.G = G;
+    state.delta = delta > 0 ? delta : choose_delta(G);
+    state.p = p;
+    state.placement = placement;
+
+    int max_weight = 1;
+    for (edge_t e = 0; e < G->num_edges(); e++) {
+        max_weight = max(max_weight, G->weights[e]);
+    }
+    if (max_weight / state.delta + 2 > MAX_DELTA_BUCKETS) {
+        dist_t widened = max_weight / (MAX_DELTA_BUCKETS - 2) + 1;
+        cerr << "delta " << state.delta << " needs more than " << MAX_DELTA_BUCKETS
+             << " buckets per thread, using delta " << widened << endl;
+        state.delta = widened;
+    }
+    state.numBuckets = max_weight / state.delta + 2;
+    cout << "delta " << state.delta << ", " << state.numBuckets << " buckets per thread" << endl;
+
+    state.distances = new atomic<dist_t>[G->num_vertices];
+    state.expanded = new atomic<dist_t>[G->num_vertices];
+    for (vertex_t i = 0; i < G->num_vertices; i++) {
+        state.distances[i].store(DIST_INF, memory_order_relaxed);
+        state.expanded[i].store(DIST_INF, memory_order_relaxed);
+    }
+    state.buckets.resize(p, vector< vector<vertex_t> >(state.numBuckets));
+    state.frontiers.resize(p);
+    state.settled.resize(p);
+    pthread_barrier_init(&state.barrier, NULL, p);
+
+    state.distances[G->source].store(0, memory_order_relaxed);
+    state.buckets[0][0].push_back(G->source);
+    state.current = 0;
+
+    vector<pthread_t> threads(p);
+    vector<DeltaThreadInput*> to_delete;
+    for (int i = 0; i < p; i++) {
+        to_delete.push_back(new DeltaThreadInput(&state, i));
+        pthread_create(&threads[i], NULL, &delta_stepping_worker, (void *) to_delete[i]);
+    }
+    for (int i = 0; i < p; i++) {
+        (void) pthread_join(threads[i], NULL);
+    }
+    for (auto input : to_delete) {
+        delete input;
+    }
+    pthread_barrier_destroy(&state.barrier);
+
+    // written while the buckets and the rest of the state are freed
+    thread writer([G, &state, &output]() {
+        write_distances(G, state.distances, string("output") + output_extension(output.format), output);
+    });
+    delete[] state.expanded;
+    state.buckets.clear();
+    state.buckets.shrink_to_fit();
+    writer.join();
+    delete[] state.distances;
+}
@@ -0,0 +1,19 @@
+#ifndef MULTIQUEUE_DELTASTEPPING_H
+#define MULTIQUEUE_DELTASTEPPING_H
+
+#include "Graph.h"
+#include "Affinity.h"
+#include "Distances.h"
+
+// Picks a bucket width from the graph: the largest weight divided by the
+// average degree, the usual choice for random weights.
+dist_t choose_delta(const Graph *G);
+
+// Parallel delta-stepping SSSP from G->source with p threads, writing the
+// distances to output.txt (output.bin) like dijkstra_shortest_path. delta <= 0
+// chooses the bucket width automatically; a delta so small that the heaviest
+// edge would span more than MAX_DELTA_BUCKETS buckets is widened, with a warning.
+void delta_stepping_shortest_path(Graph *G, dist_t delta, int p, const ThreadPlacement *placement = NULL,
+                                  const OutputOptions &output = OutputOptions());
+
+#endif //MULTIQUEUE_DELTASTEPPING_H
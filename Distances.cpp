@@ -0,0 +1,220 @@
+#include "Distances.h"
+#include "Parallel.h"
+#include <fstream>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// bytes of text each writer thread formats before handing them to pwrite
+#define WRITE_CHUNK (1 << 20)
+
+
+bool parse_output_format(const std::string &name, OutputFormat *format) {
+    if (name == "text") {
+        *format = OUTPUT_TEXT;
+    } else if (name == "binary") {
+        *format = OUTPUT_BINARY;
+    } else if (name == "mmap") {
+        *format = OUTPUT_MMAP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+const char *output_extension(OutputFormat format) {
+    return format == OUTPUT_TEXT ? ".txt" : ".bin";
+}
+
+
+static size_t decimal_length(int64_t value) {
+    uint64_t u = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+    size_t length = value < 0 ? 2 : 1;
+    while (u >= 10) {
+        u /= 10;
+        length++;
+    }
+    return length;
+}
+
+
+// writes value in decimal at out and returns its length
+static size_t format_decimal(int64_t value, char *out) {
+    char digits[20];
+    size_t k = 0;
+    uint64_t u = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+    do {
+        digits[k++] = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u);
+    size_t length = 0;
+    if (value < 0) {
+        out[length++] = '-';
+    }
+    while (k) {
+        out[length++] = digits[--k];
+    }
+    return length;
+}
+
+
+static bool write_fully(int fd, const char *data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            return false;
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+
+// Writes value(i) for i in [0, n) to path on options.numOfThreads threads.
+// Text: every thread measures its slice, so it knows where its lines start,
+// then formats them into a buffer that goes out with one pwrite per chunk.
+// Binary and mmap: the values as T, in native byte order, at i * sizeof(T).
+template <typename T, typename Value>
+static void write_values(size_t n, const Value &value, const std::string &path, const OutputOptions &options) {
+    int threads = max(1, options.numOfThreads);
+    int fd = open(path.c_str(), options.format == OUTPUT_MMAP ? O_RDWR | O_CREAT | O_TRUNC : O_WRONLY | O_CREAT | O_TRUNC,
+                  0644);
+    if (fd < 0) {
+        cerr << "Unable to open file " << path << endl;
+        return;
+    }
+
+    vector<size_t> start(threads + 1, 0);
+    if (options.format == OUTPUT_TEXT) {
+        for_each_slice(n, threads, [&](int t, size_t first, size_t last) {
+            size_t bytes = 0;
+            for (size_t i = first; i < last; i++) {
+                bytes += decimal_length(value(i)) + 1;
+            }
+            start[t + 1] = bytes;
+        });
+        for (int t = 0; t < threads; t++) {
+            start[t + 1] += start[t];
+        }
+    } else {
+        start[threads] = n * sizeof(T);
+    }
+    bool ok = ftruncate(fd, start[threads]) == 0;
+
+    if (ok && options.format == OUTPUT_MMAP && n > 0) {
+        void *map = mmap(NULL, n * sizeof(T), PROT_WRITE, MAP_SHARED, fd, 0);
+        ok = map != MAP_FAILED;
+        if (ok) {
+            T *out = (T *) map;
+            for_each_slice(n, threads, [&](int, size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    out[i] = (T) value(i);
+                }
+            });
+            ok = munmap(map, n * sizeof(T)) == 0;
+        }
+    } else if (ok && n > 0) {
+        vector<char> failed(threads, 0);
+        for_each_slice(n, threads, [&](int t, size_t first, size_t last) {
+            vector<char> buffer(WRITE_CHUNK);
+            off_t offset = options.format == OUTPUT_TEXT ? start[t] : first * sizeof(T);
+            size_t used = 0;
+            for (size_t i = first; i < last && !failed[t]; i++) {
+                if (used + 24 > buffer.size()) {
+                    failed[t] = !write_fully(fd, buffer.data(), used, offset);
+                    offset += used;
+                    used = 0;
+                }
+                if (options.format == OUTPUT_TEXT) {
+                    used += format_decimal(value(i), buffer.data() + used);
+                    buffer[used++] = '\n';
+                } else {
+                    T v = (T) value(i);
+                    memcpy(buffer.data() + used, &v, sizeof(T));
+                    used += sizeof(T);
+                }
+            }
+            if (!failed[t]) {
+                failed[t] = !write_fully(fd, buffer.data(), used, offset);
+            }
+        });
+        for (int t = 0; t < threads; t++) {
+            ok = ok && !failed[t];
+        }
+    }
+    if (close(fd) != 0 || !ok) {
+        cerr << "Unable to write file " << path << endl;
+    }
+}
+
+
+void write_distances(const Graph *G, const std::atomic<dist_t> *distances, const std::string &path,
+                     const OutputOptions &options) {
+    write_values<dist_t>(G->num_vertices, [G, distances](size_t i) -> int64_t {
+        return distances[G->internal_id(i)].load(std::memory_order_relaxed);
+    }, path, options);
+}
+
+
+void write_distances(const Graph *G, const dist_t *distances, const std::string &path, const OutputOptions &options) {
+    write_values<dist_t>(G->num_vertices, [G, distances](size_t i) -> int64_t {
+        return distances[G->internal_id(i)];
+    }, path, options);
+}
+
+
+vector<uint64_t> file_ids(const Graph *G) {
+    vector<uint64_t> ids(G->num_vertices);
+    for (vertex_t i = 0; i < G->num_vertices; i++) {
+        ids[G->internal_id(i)] = (uint64_t) i + G->id_base;
+    }
+    return ids;
+}
+
+
+void write_predecessors(const Graph *G, const std::atomic<label_t> *labels, const std::string &path,
+                        const OutputOptions &options) {
+    vector<uint64_t> ids = file_ids(G);
+    write_values<vertex_t>(G->num_vertices, [G, labels, &ids](size_t i) -> int64_t {
+        vertex_t from = label_vertex(labels[G->internal_id(i)].load(std::memory_order_relaxed));
+        return from == NO_VERTEX ? -1 : (int64_t) ids[from];
+    }, path, options);
+}
+
+
+void write_pairs(const std::vector<Query> &queries, const std::vector<dist_t> &answers, const std::string &path) {
+    ofstream pairs;
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (queries[i].target == NO_TARGET) {
+            continue;
+        }
+        if (!pairs.is_open()) {
+            pairs.open(path.c_str());
+        }
+        pairs << queries[i].source << " " << queries[i].target << " " << answers[i] << "\n";
+    }
+}
+
+
+void write_paths(const Graph *G, const std::vector<Query> &queries, const std::vector<dist_t> &answers,
+                 const std::vector<std::vector<vertex_t> > &paths, const std::string &path) {
+    vector<uint64_t> ids = file_ids(G);
+    ofstream out;
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (queries[i].target == NO_TARGET) {
+            continue;
+        }
+        if (!out.is_open()) {
+            out.open(path.c_str());
+        }
+        out << queries[i].source << " " << queries[i].target << " " << answers[i];
+        for (size_t j = 0; j < paths[i].size(); j++) {
+            out << " " << ids[paths[i][j]];
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef MULTIQUEUE_DISTANCES_H
+#define MULTIQUEUE_DISTANCES_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "Graph.h"
+
+// Lowers word to value unless it already holds something no larger.
+// Returns true when this call performed the update.
+static inline bool atomic_min(std::atomic<dist_t> &word, dist_t value) {
+    dist_t curr = word.load(std::memory_order_relaxed);
+    while (value < curr) {
+        if (word.compare_exchange_weak(curr, value)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A key packed with the vertex whose relaxation offered it, key in the high
+// half: packed labels order like their keys, so atomic_min on the label keeps
+// the smallest key and a vertex that offered it with a single CAS.
+#ifdef MQ_64BIT
+typedef unsigned __int128 label_t;
+#else
+typedef uint64_t label_t;
+#endif
+#define NO_VERTEX (std::numeric_limits<vertex_t>::max())
+
+static inline label_t make_label(dist_t key, vertex_t from) {
+    return ((label_t) key << (8 * sizeof(vertex_t))) | from;
+}
+static inline dist_t label_key(label_t label) {
+    return (dist_t) (label >> (8 * sizeof(vertex_t)));
+}
+static inline vertex_t label_vertex(label_t label) {
+    return (vertex_t) label;
+}
+
+static inline bool atomic_min(std::atomic<label_t> &word, label_t value) {
+    label_t curr = word.load(std::memory_order_relaxed);
+    while (value < curr) {
+        if (word.compare_exchange_weak(curr, value)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Batch queries name vertices as written in the input file; a query without a
+// target asks for the distances to every vertex.
+#define NO_TARGET UINT64_MAX
+
+struct Query {
+    uint64_t source;
+    uint64_t target;
+};
+
+// file_ids(G)[v] is the id vertex v of G has in the input file
+std::vector<uint64_t> file_ids(const Graph *G);
+
+// How per-vertex results are written: text, one decimal value per line, or
+// the raw values in native byte order, through pwrite or a shared mapping.
+enum OutputFormat {
+    OUTPUT_TEXT,
+    OUTPUT_BINARY,
+    OUTPUT_MMAP
+};
+
+bool parse_output_format(const std::string &name, OutputFormat *format);
+// ".txt" for text, ".bin" otherwise
+const char *output_extension(OutputFormat format);
+
+struct OutputOptions {
+    OutputFormat format;
+    int numOfThreads;           // threads formatting and writing
+
+    OutputOptions() : format(OUTPUT_TEXT), numOfThreads(1) {}
+};
+
+// Writes the distance of every vertex, in the input file's vertex order: one
+// per line, or as dist_t values.
+void write_distances(const Graph *G, const std::atomic<dist_t> *distances, const std::string &path,
+                     const OutputOptions &options = OutputOptions());
+void write_distances(const Graph *G, const dist_t *distances, const std::string &path,
+                     const OutputOptions &options = OutputOptions());
+
+// Writes the predecessor of every vertex on its shortest path, in the input
+// file's vertex order: its file id, or -1 for the source and for vertices
+// that were not reached (all ones as a binary vertex_t).
+void write_predecessors(const Graph *G, const std::atomic<label_t> *labels, const std::string &path,
+                        const OutputOptions &options = OutputOptions());
+
+// Writes one "source target distance" line per point-to-point query, if there
+// are any; answers[i] belongs to queries[i].
+void write_pairs(const std::vector<Query> &queries, const std::vector<dist_t> &answers, const std::string &path);
+
+// Like write_pairs, each line followed by the vertices of the path (file ids,
+// source first); paths[i] holds ids of G and is empty for an unreachable target.
+void write_paths(const Graph *G, const std::vector<Query> &queries, const std::vector<dist_t> &answers,
+                 const std::vector<std::vector<vertex_t> > &paths, const std::string &path);
+
+#endif //MULTIQUEUE_DISTANCES_H
@@ -0,0 +1,420 @@
+#include "Generator.h"
+#include "GraphLoader.h"
+#include "Parallel.h"
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <stdlib.h>
+#include <errno.h>
+
+using namespace std;
+
+// edges (RMAT, ER) or vertices (grids, geometric) drawn from one stream
+#define GENERATOR_BLOCK 65536
+
+
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+// splitmix64, one stream per block: the stream depends only on the seed and
+// the block number, never on the thread that draws it
+class Random {
+    public:
+        Random(uint64_t seed, uint64_t stream) : state(mix64(seed ^ mix64(stream + 0x9e3779b97f4a7c15ULL))) {}
+        uint64_t next() {
+            this->state += 0x9e3779b97f4a7c15ULL;
+            return mix64(this->state);
+        }
+        // uniform in [0, n)
+        uint64_t below(uint64_t n) { return (uint64_t) (((unsigned __int128) this->next() * n) >> 64); }
+        // uniform in [0, 1)
+        double uniform() { return (this->next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    private:
+        uint64_t state;
+};
+
+
+static int draw_weight(Random &random, const GeneratorOptions &options) {
+    int lo = options.min_weight;
+    int hi = options.max_weight;
+    if (options.weights == WEIGHTS_LOG) {
+        int w = (int) (lo * exp(random.uniform() * log((hi + 1.0) / lo)));
+        return min(max(w, lo), hi);
+    }
+    if (options.weights == WEIGHTS_UNIFORM) {
+        return lo + (int) random.below((uint64_t) (hi - lo) + 1);
+    }
+    return lo;
+}
+
+
+// Collects the edges of one thread; self-loops are only counted.
+struct EdgeSink {
+    vector<Edge> edges;
+    size_t loops;
+
+    EdgeSink() : loops(0) {}
+    void add(uint64_t u, uint64_t v, int weight) {
+        if (u == v) {
+            loops++;
+            return;
+        }
+        Edge edge;
+        edge.u = (vertex_t) u;
+        edge.v = (vertex_t) v;
+        edge.weight = weight;
+        edges.push_back(edge);
+    }
+};
+
+typedef function<void(Random &, uint64_t, uint64_t, EdgeSink &)> BlockBody;
+
+// Runs body(random, first, last, sink) over [0, count) in blocks of
+// GENERATOR_BLOCK, block b drawing from stream b of seed.
+static void draw_blocks(uint64_t count, uint64_t seed, vector<EdgeSink> &sinks, const BlockBody &body) {
+    size_t blocks = (count + GENERATOR_BLOCK - 1) / GENERATOR_BLOCK;
+    for_each_index(blocks, (int) sinks.size(), [&](int t, size_t b) {
+        Random random(seed, b);
+        uint64_t first = (uint64_t) b * GENERATOR_BLOCK;
+        uint64_t last = min(first + GENERATOR_BLOCK, count);
+        body(random, first, last, sinks[t]);
+    }, 1);
+}
+
+
+// Each edge descends scale levels of the adjacency matrix, picking a
+// quadrant with probabilities a, b, c, d. Vertex ids are then scrambled by a
+// seeded bijection, so the heavy vertices are not all near 0.
+static uint64_t rmat_edges(const GeneratorOptions &options, vector<EdgeSink> &sinks) {
+    int scale = 0;
+    while ((1ULL << scale) < options.num_vertices) {
+        scale++;
+    }
+    uint64_t n = 1ULL << scale;
+    uint64_t m = (uint64_t) (options.degree * n);
+    uint64_t mask = n - 1;
+    uint64_t k1 = mix64(options.seed) | 1;
+    uint64_t k2 = mix64(options.seed + 1) | 1;
+    int shift = scale / 2 + 1;
+    // quadrant thresholds on 32-bit draws, two levels per 64-bit number
+    uint64_t a = (uint64_t) (options.a * 4294967296.0);
+    uint64_t ab = (uint64_t) ((options.a + options.b) * 4294967296.0);
+    uint64_t abc = (uint64_t) ((options.a + options.b + options.c) * 4294967296.0);
+    auto scramble = [mask, k1, k2, shift](uint64_t x) {
+        x = (x * k1) & mask;
+        x ^= x >> shift;
+        return (x * k2) & mask;
+    };
+
+    draw_blocks(m, options.seed, sinks, [&](Random &random, uint64_t first, uint64_t last, EdgeSink &sink) {
+        for (uint64_t i = first; i < last; i++) {
+            uint64_t u = 0, v = 0;
+            uint64_t bits = 0;
+            for (int level = 0; level < scale; level++) {
+                if (level % 2 == 0) {
+                    bits = random.next();
+                }
+                uint64_t r = level % 2 == 0 ? bits & 0xffffffffULL : bits >> 32;
+                u = (u << 1) | (r >= ab);
+                v = (v << 1) | ((r >= a) ^ (r >= ab) ^ (r >= abc));
+            }
+            sink.add(scramble(u), scramble(v), draw_weight(random, options));
+        }
+    });
+    return n;
+}
+
+
+static uint64_t er_edges(const GeneratorOptions &options, vector<EdgeSink> &sinks) {
+    uint64_t n = options.num_vertices;
+    uint64_t m = (uint64_t) (options.degree * n);
+    draw_blocks(m, options.seed, sinks, [&](Random &random, uint64_t first, uint64_t last, EdgeSink &sink) {
+        for (uint64_t i = first; i < last; i++) {
+            uint64_t u = random.below(n);
+            uint64_t v = random.below(n);
+            sink.add(u, v, draw_weight(random, options));
+        }
+    });
+    return n;
+}
+
+
+// Vertex x + side * y (+ side^2 * z) is joined to its successor along every
+// axis; a directed grid gets both arcs, each with its own weight.
+static uint64_t grid_edges(const GeneratorOptions &options, int dimensions, vector<EdgeSink> &sinks) {
+    uint64_t side = max((uint64_t) llround(pow((double) options.num_vertices, 1.0 / dimensions)), (uint64_t) 1);
+    uint64_t n = 1;
+    for (int d = 0; d < dimensions; d++) {
+        n *= side;
+    }
+    draw_blocks(n, options.seed, sinks, [&](Random &random, uint64_t first, uint64_t last, EdgeSink &sink) {
+        for (uint64_t v = first; v < last; v++) {
+            uint64_t stride = 1;
+            for (int d = 0; d < dimensions; d++, stride *= side) {
+                if ((v / stride) % side == side - 1) {
+                    continue;
+                }
+                sink.add(v, v + stride, draw_weight(random, options));
+                if (options.directed) {
+                    sink.add(v + stride, v, draw_weight(random, options));
+                }
+            }
+        }
+    });
+    return n;
+}
+
+
+// Points uniform in the unit square, joined when closer than the radius r at
+// which a vertex expects 2 * degree neighbors. Points are bucketed into cells
+// at least r wide, so each vertex only looks at its own and the 8 adjacent
+// cells.
+static uint64_t geometric_edges(const GeneratorOptions &options, vector<EdgeSink> &sinks) {
+    uint64_t n = options.num_vertices;
+    int numOfThreads = (int) sinks.size();
+    double radius = min(sqrt(2 * options.degree / (M_PI * n)), 1.0);
+    uint64_t cells = max((uint64_t) (1 / radius), (uint64_t) 1);
+
+    vector<double> x(n), y(n);
+    vector<uint64_t> cell(n);
+    size_t blocks = (n + GENERATOR_BLOCK - 1) / GENERATOR_BLOCK;
+    for_each_index(blocks, numOfThreads, [&](int, size_t b) {
+        Random random(options.seed, b);
+        uint64_t last = min((uint64_t) (b + 1) * GENERATOR_BLOCK, n);
+        for (uint64_t v = (uint64_t) b * GENERATOR_BLOCK; v < last; v++) {
+            x[v] = random.uniform();
+            y[v] = random.uniform();
+            cell[v] = min((uint64_t) (x[v] * cells), cells - 1) + cells * min((uint64_t) (y[v] * cells), cells - 1);
+        }
+    }, 1);
+
+    // the vertices of cell c are members[start[c] .. start[c + 1])
+    vector<uint64_t> start(cells * cells + 1, 0);
+    for (uint64_t v = 0; v < n; v++) {
+        start[cell[v] + 1]++;
+    }
+    for (uint64_t c = 0; c < cells * cells; c++) {
+        start[c + 1] += start[c];
+    }
+    vector<vertex_t> members(n);
+    vector<uint64_t> fill(start.begin(), start.end() - 1);
+    for (uint64_t v = 0; v < n; v++) {
+        members[fill[cell[v]]++] = (vertex_t) v;
+    }
+
+    // weights come from streams of their own, apart from the points'
+    double r2 = radius * radius;
+    draw_blocks(n, mix64(options.seed), sinks, [&](Random &random, uint64_t first, uint64_t last, EdgeSink &sink) {
+        for (uint64_t u = first; u < last; u++) {
+            int64_t cx = (int64_t) (cell[u] % cells);
+            int64_t cy = (int64_t) (cell[u] / cells);
+            for (int64_t ny = max(cy - 1, (int64_t) 0); ny <= min(cy + 1, (int64_t) cells - 1); ny++) {
+                for (int64_t nx = max(cx - 1, (int64_t) 0); nx <= min(cx + 1, (int64_t) cells - 1); nx++) {
+                    uint64_t c = (uint64_t) nx + cells * (uint64_t) ny;
+                    for (uint64_t i = start[c]; i < start[c + 1]; i++) {
+                        vertex_t v = members[i];
+                        double dx = x[u] - x[v], dy = y[u] - y[v];
+                        double d2 = dx * dx + dy * dy;
+                        if (v <= u || d2 >= r2) {
+                            continue;
+                        }
+                        int weight = options.weights == WEIGHTS_EUCLIDEAN ?
+                                     max(options.min_weight, (int) llround(sqrt(d2) / radius * options.max_weight)) :
+                                     draw_weight(random, options);
+                        sink.add(u, v, weight);
+                        if (options.directed) {
+                            sink.add(v, u, options.weights == WEIGHTS_EUCLIDEAN ? weight :
+                                           draw_weight(random, options));
+                        }
+                    }
+                }
+            }
+        }
+    });
+    return n;
+}
+
+
+bool parse_graph_model(const std::string &name, GraphModel *model) {
+    if (name == "rmat") {
+        *model = MODEL_RMAT;
+    } else if (name == "grid2d") {
+        *model = MODEL_GRID2D;
+    } else if (name == "grid3d") {
+        *model = MODEL_GRID3D;
+    } else if (name == "geometric") {
+        *model = MODEL_GEOMETRIC;
+    } else if (name == "er") {
+        *model = MODEL_ER;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+// a count with an optional k, M or G suffix
+static bool parse_count(const string &text, uint64_t *count) {
+    char *end;
+    double value = strtod(text.c_str(), &end);
+    string suffix(end);
+    if (suffix == "k" || suffix == "K") {
+        value *= 1e3;
+    } else if (suffix == "M") {
+        value *= 1e6;
+    } else if (suffix == "G") {
+        value *= 1e9;
+    } else if (!suffix.empty() || end == text.c_str()) {
+        return false;
+    }
+    if (value < 1) {
+        return false;
+    }
+    *count = (uint64_t) value;
+    return true;
+}
+
+
+// a whole decimal integer in [lo, hi], nothing else
+static bool parse_int(const string &text, long long lo, long long hi, int *out) {
+    char *end;
+    errno = 0;
+    long long value = strtoll(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0' || errno == ERANGE || value < lo || value > hi) {
+        return false;
+    }
+    *out = (int) value;
+    return true;
+}
+
+
+bool parse_generator_spec(const std::string &spec, GeneratorOptions *options) {
+    size_t colon = spec.find(':');
+    if (!parse_graph_model(spec.substr(0, colon), &options->model)) {
+        cerr << "Unknown graph model " << spec.substr(0, colon) << endl;
+        return false;
+    }
+    istringstream fields(colon == string::npos ? "" : spec.substr(colon + 1));
+    string field;
+    while (getline(fields, field, ',')) {
+        size_t eq = field.find('=');
+        string key = field.substr(0, eq);
+        string value = eq == string::npos ? "" : field.substr(eq + 1);
+        bool ok = true;
+        if (key == "n") {
+            ok = parse_count(value, &options->num_vertices);
+        } else if (key == "scale") {
+            int scale;
+            ok = parse_int(value, 0, 62, &scale);
+            options->num_vertices = ok ? 1ULL << scale : options->num_vertices;
+        } else if (key == "degree") {
+            options->degree = atof(value.c_str());
+            ok = options->degree > 0;
+        } else if (key == "weights") {
+            if (value == "uniform") {
+                options->weights = WEIGHTS_UNIFORM;
+            } else if (value == "log") {
+                options->weights = WEIGHTS_LOG;
+            } else if (value == "constant") {
+                options->weights = WEIGHTS_CONSTANT;
+            } else if (value == "euclidean") {
+                options->weights = WEIGHTS_EUCLIDEAN;
+            } else {
+                ok = false;
+            }
+        } else if (key == "min") {
+            ok = parse_int(value, 0, DELETED_WEIGHT - 1, &options->min_weight);
+        } else if (key == "max") {
+            ok = parse_int(value, 0, DELETED_WEIGHT - 1, &options->max_weight);
+        } else if (key == "seed") {
+            options->seed = strtoull(value.c_str(), NULL, 10);
+        } else if (key == "a") {
+            options->a = atof(value.c_str());
+        } else if (key == "b") {
+            options->b = atof(value.c_str());
+        } else if (key == "c") {
+            options->c = atof(value.c_str());
+        } else {
+            cerr << "Unknown generator parameter " << key << endl;
+            return false;
+        }
+        if (!ok) {
+            cerr << "Bad value for generator parameter " << key << ": " << value << endl;
+            return false;
+        }
+    }
+    if (options->min_weight < 0 || options->max_weight < options->min_weight ||
+        (options->weights == WEIGHTS_LOG && options->min_weight < 1)) {
+        cerr << "Weights need 0 <= min <= max (1 <= min for log weights)" << endl;
+        return false;
+    }
+    if (options->weights == WEIGHTS_EUCLIDEAN && options->model != MODEL_GEOMETRIC) {
+        cerr << "Euclidean weights are for geometric graphs" << endl;
+        return false;
+    }
+    if (options->a < 0 || options->b < 0 || options->c < 0 || options->a + options->b + options->c > 1) {
+        cerr << "RMAT needs a, b, c >= 0 with a + b + c <= 1" << endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool generate_graph(const GeneratorOptions &options, Graph *G) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    int numOfThreads = max(options.numOfThreads, 1);
+    vector<EdgeSink> sinks(numOfThreads);
+    uint64_t n;
+    if (options.model == MODEL_RMAT) {
+        n = rmat_edges(options, sinks);
+    } else if (options.model == MODEL_ER) {
+        n = er_edges(options, sinks);
+    } else if (options.model == MODEL_GEOMETRIC) {
+        n = geometric_edges(options, sinks);
+    } else {
+        n = grid_edges(options, options.model == MODEL_GRID2D ? 2 : 3, sinks);
+    }
+    if (n > numeric_limits<vertex_t>::max()) {
+        cerr << "too many vertices for this build, rebuild with BITS=64" << endl;
+        return false;
+    }
+    uint64_t source = options.source >= 0 ? options.source : 0;
+    if (source >= n) {
+        cerr << "source vertex is out of range" << endl;
+        return false;
+    }
+
+    chrono::steady_clock::time_point drawn = chrono::steady_clock::now();
+    vector< vector<Edge> > parts(numOfThreads);
+    size_t loops = 0;
+    for (int t = 0; t < numOfThreads; t++) {
+        parts[t].swap(sinks[t].edges);
+        loops += sinks[t].loops;
+    }
+    G->source = (vertex_t) source;
+    G->id_base = 0;
+    G->build((vertex_t) n, parts, options.directed, options.directed && options.reverse ? new Graph() : NULL);
+    parts.clear();
+    edge_t parallel = G->remove_parallel_edges(numOfThreads);
+    if (G->reverse) {
+        G->reverse->remove_parallel_edges(numOfThreads);
+        G->reverse->source = G->source;
+    }
+
+    chrono::steady_clock::time_point built = chrono::steady_clock::now();
+    if (loops || parallel) {
+        cout << "dropped " << loops << " self-loops and " << parallel << " parallel arcs" << endl;
+    }
+    cout << "generated " << n << " vertices, " << G->num_edges() << " arcs in "
+         << chrono::duration<double>(built - start).count() << " s (draw "
+         << chrono::duration<double>(drawn - start).count() << " s, " << numOfThreads << " threads)" << endl;
+    report_graph_memory(G);
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef MULTIQUEUE_GENERATOR_H
+#define MULTIQUEUE_GENERATOR_H
+
+#include <string>
+#include <stdint.h>
+#include "Graph.h"
+
+enum GraphModel {
+    MODEL_RMAT,         // recursive matrix (Kronecker) graph, skewed degrees; n rounds up to a power of two
+    MODEL_GRID2D,       // square grid, 4 neighbors; n rounds to the nearest square
+    MODEL_GRID3D,       // cubic grid, 6 neighbors; n rounds to the nearest cube
+    MODEL_GEOMETRIC,    // random points in the unit square, joined when closer than a radius
+    MODEL_ER            // Erdos-Renyi G(n, m): m uniformly random vertex pairs
+};
+
+enum WeightDistribution {
+    WEIGHTS_UNIFORM,    // uniform in [min, max]
+    WEIGHTS_LOG,        // log-uniform in [min, max]: most edges light, a few heavy
+    WEIGHTS_CONSTANT,   // every edge weighs min
+    WEIGHTS_EUCLIDEAN   // geometric: the edge's length, scaled so the radius weighs max
+};
+
+struct GeneratorOptions {
+    GraphModel model;
+    uint64_t num_vertices;
+    double degree;          // edges drawn per vertex (RMAT, ER) or expected per vertex (geometric)
+    WeightDistribution weights;
+    int min_weight;
+    int max_weight;
+    double a, b, c;         // RMAT quadrant probabilities, d = 1 - a - b - c
+    uint64_t seed;
+    int numOfThreads;
+    bool directed;          // keep arcs as drawn; grids and geometric graphs get both arcs
+    bool reverse;           // directed: also build G->reverse
+    int64_t source;         // -1: vertex 0
+
+    GeneratorOptions() : model(MODEL_RMAT), num_vertices(1 << 20), degree(8), weights(WEIGHTS_UNIFORM),
+                         min_weight(1), max_weight(255), a(0.57), b(0.19), c(0.19), seed(1), numOfThreads(1),
+                         directed(false), reverse(false), source(-1) {}
+};
+
+// Parses a model name ("rmat", "grid2d", "grid3d", "geometric", "er").
+// Returns false for anything else.
+bool parse_graph_model(const std::string &name, GraphModel *model);
+
+// Parses "model[:key=value,...]" into options, keeping the defaults of keys
+// that are not given. Keys: n (count, with an optional k, M or G suffix),
+// scale (n = 2^scale), degree, weights (uniform, log, constant or
+// euclidean), min and max (below DELETED_WEIGHT), seed, and a, b, c for RMAT.
+// Returns false, with a message on cerr, for an unknown model or key or a
+// value that is malformed or out of range.
+bool parse_generator_spec(const std::string &spec, GeneratorOptions *options);
+
+// Generates the graph into G on options.numOfThreads threads. The edges are
+// drawn in fixed blocks, each from its own seeded stream, so a seed gives the
+// same graph whatever the number of threads. Self-loops are dropped and
+// parallel edges collapsed to the lightest, as when loading. Returns false if
+// the graph does not fit this build's vertex ids.
+bool generate_graph(const GeneratorOptions &options, Graph *G);
+
+#endif //MULTIQUEUE_GENERATOR_H
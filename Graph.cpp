@@ -0,0 +1,380 @@
+#include "Graph.h"
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <sys/mman.h>
+
+
+Graph::~Graph() {
+    delete this->reverse;
+    if (this->mapping) {
+        munmap(this->mapping, this->mapping_size);
+    }
+}
+
+
+// Makes the graph responsible for unmapping a file its arrays view into.
+void Graph::adopt_mapping(void *addr, size_t size) {
+    this->mapping = addr;
+    this->mapping_size = size;
+}
+
+
+// Builds the undirected CSR from an edge list: every edge is stored once in
+// each endpoint's adjacency, in input order.
+void Graph::build(vertex_t n, const vector<Edge> &edges) {
+    this->num_vertices = n;
+    this->offsets.assign((size_t) n + 1, 0);
+    this->targets.resize(2 * edges.size());
+    this->weights.resize(2 * edges.size());
+
+    for (size_t i = 0; i < edges.size(); i++) {
+        this->offsets[edges[i].u + 1]++;
+        this->offsets[edges[i].v + 1]++;
+    }
+    for (vertex_t v = 0; v < n; v++) {
+        this->offsets[v + 1] += this->offsets[v];
+    }
+
+    vector <edge_t> next(this->offsets.begin(), this->offsets.end() - 1);
+    for (size_t i = 0; i < edges.size(); i++) {
+        const Edge &e = edges[i];
+        edge_t a = next[e.u]++;
+        this->targets[a] = e.v;
+        this->weights[a] = e.weight;
+        edge_t b = next[e.v]++;
+        this->targets[b] = e.u;
+        this->weights[b] = e.weight;
+    }
+}
+
+
+// Same layout as above, built from edge lists produced by separate threads
+// (one list per thread). Degrees are counted and edges scattered in parallel,
+// one thread per list, so the order within an adjacency is not deterministic.
+// A directed graph keeps each edge as the arc u -> v only; with a reverse
+// graph given, the same pass also fills it with the arcs v -> u.
+void Graph::build(vertex_t n, const vector< vector<Edge> > &parts, bool directed, Graph *reverse) {
+    size_t m = 0;
+    for (size_t t = 0; t < parts.size(); t++) {
+        m += parts[t].size();
+    }
+    size_t arcs = directed ? m : 2 * m;
+    this->num_vertices = n;
+    this->directed = directed;
+    this->targets.resize(arcs);
+    this->weights.resize(arcs);
+
+    // in-arcs of a directed graph share the scatter pass through a second cursor array
+    bool both = directed && reverse != NULL;
+    atomic<edge_t> *cursor = new atomic<edge_t>[(size_t) n + 1];
+    atomic<edge_t> *rcursor = both ? new atomic<edge_t>[(size_t) n + 1] : NULL;
+    for (vertex_t v = 0; v <= n; v++) {
+        cursor[v].store(0, memory_order_relaxed);
+        if (both) {
+            rcursor[v].store(0, memory_order_relaxed);
+        }
+    }
+    // undirected: the second copy of an edge goes to v's list of this graph
+    atomic<edge_t> *vcursor = directed ? rcursor : cursor;
+
+    vector<thread> workers;
+    for (size_t t = 0; t < parts.size(); t++) {
+        workers.push_back(thread([&parts, cursor, vcursor, t]() {
+            const vector<Edge> &edges = parts[t];
+            for (size_t i = 0; i < edges.size(); i++) {
+                cursor[edges[i].u].fetch_add(1, memory_order_relaxed);
+                if (vcursor) {
+                    vcursor[edges[i].v].fetch_add(1, memory_order_relaxed);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    workers.clear();
+
+    // exclusive prefix sums; cursor[v] becomes the next free slot of v
+    this->offsets.resize((size_t) n + 1);
+    edge_t sum = 0;
+    for (vertex_t v = 0; v < n; v++) {
+        edge_t deg = cursor[v].load(memory_order_relaxed);
+        this->offsets[v] = sum;
+        cursor[v].store(sum, memory_order_relaxed);
+        sum += deg;
+    }
+    this->offsets[n] = sum;
+
+    vertex_t *targets = this->targets.data();
+    int *weights = this->weights.data();
+    vertex_t *rtargets = targets;
+    int *rweights = weights;
+    if (both) {
+        reverse->num_vertices = n;
+        reverse->source = this->source;
+        reverse->id_base = this->id_base;
+        reverse->directed = true;
+        reverse->offsets.resize((size_t) n + 1);
+        reverse->targets.resize(m);
+        reverse->weights.resize(m);
+        sum = 0;
+        for (vertex_t v = 0; v < n; v++) {
+            edge_t deg = rcursor[v].load(memory_order_relaxed);
+            reverse->offsets[v] = sum;
+            rcursor[v].store(sum, memory_order_relaxed);
+            sum += deg;
+        }
+        reverse->offsets[n] = sum;
+        rtargets = reverse->targets.data();
+        rweights = reverse->weights.data();
+    }
+
+    for (size_t t = 0; t < parts.size(); t++) {
+        workers.push_back(thread([&parts, cursor, vcursor, targets, weights, rtargets, rweights, t]() {
+            const vector<Edge> &edges = parts[t];
+            for (size_t i = 0; i < edges.size(); i++) {
+                const Edge &e = edges[i];
+                edge_t a = cursor[e.u].fetch_add(1, memory_order_relaxed);
+                targets[a] = e.v;
+                weights[a] = e.weight;
+                if (vcursor) {
+                    edge_t b = vcursor[e.v].fetch_add(1, memory_order_relaxed);
+                    rtargets[b] = e.u;
+                    rweights[b] = e.weight;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    delete[] cursor;
+    delete[] rcursor;
+    if (both) {
+        delete this->reverse;
+        this->reverse = reverse;
+    }
+}
+
+
+// Builds the reverse of a directed graph from its CSR, for graphs that were
+// not parsed from edge lists (a mapped binary graph). Every thread takes a
+// slice of the vertices and scatters their arcs into the in-lists.
+void Graph::build_reverse(int numOfThreads) {
+    vertex_t n = this->num_vertices;
+    Graph *R = new Graph();
+    R->num_vertices = n;
+    R->source = this->source;
+    R->id_base = this->id_base;
+    R->directed = true;
+    R->offsets.resize((size_t) n + 1);
+    R->targets.resize(this->num_edges());
+    R->weights.resize(this->num_edges());
+
+    atomic<edge_t> *cursor = new atomic<edge_t>[(size_t) n + 1];
+    for (vertex_t v = 0; v <= n; v++) {
+        cursor[v].store(0, memory_order_relaxed);
+    }
+    vector<thread> workers;
+    for (int t = 0; t < numOfThreads; t++) {
+        vertex_t first = (vertex_t) ((uint64_t) n * t / numOfThreads);
+        vertex_t last = (vertex_t) ((uint64_t) n * (t + 1) / numOfThreads);
+        workers.push_back(thread([this, cursor, first, last]() {
+            for (edge_t e = this->offsets[first]; e < this->offsets[last]; e++) {
+                cursor[this->targets[e]].fetch_add(1, memory_order_relaxed);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    workers.clear();
+
+    edge_t sum = 0;
+    for (vertex_t v = 0; v < n; v++) {
+        edge_t deg = cursor[v].load(memory_order_relaxed);
+        R->offsets[v] = sum;
+        cursor[v].store(sum, memory_order_relaxed);
+        sum += deg;
+    }
+    R->offsets[n] = sum;
+
+    for (int t = 0; t < numOfThreads; t++) {
+        vertex_t first = (vertex_t) ((uint64_t) n * t / numOfThreads);
+        vertex_t last = (vertex_t) ((uint64_t) n * (t + 1) / numOfThreads);
+        workers.push_back(thread([this, R, cursor, first, last]() {
+            for (vertex_t u = first; u < last; u++) {
+                for (edge_t e = this->offsets[u]; e < this->offsets[u + 1]; e++) {
+                    edge_t b = cursor[this->targets[e]].fetch_add(1, memory_order_relaxed);
+                    R->targets[b] = u;
+                    R->weights[b] = this->weights[e];
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    delete[] cursor;
+    delete this->reverse;
+    this->reverse = R;
+}
+
+
+// Sets the weight of each arc u -> v in updates, of v -> u as well when the
+// graph is undirected, and of the matching arc of the reverse graph. A
+// weight of DELETED_WEIGHT deletes the arc. previous[i] receives the weight
+// that updates[i] replaced, DELETED_WEIGHT if the arc was missing. Missing
+// arcs are inserted together at the end, which copies the arrays, with the
+// last weight the batch gives them (none if it deletes them again); every
+// other update is done in place.
+void Graph::update_arcs(const vector<Edge> &updates, vector<int> *previous) {
+    previous->assign(updates.size(), DELETED_WEIGHT);
+    vector<Edge> missing;
+    vector<Edge> missingReverse;
+    for (size_t i = 0; i < updates.size(); i++) {
+        const Edge &update = updates[i];
+        edge_t e;
+        if (this->find_arc(update.u, update.v, &e)) {
+            (*previous)[i] = this->weights[e];
+            this->weights[e] = update.weight;
+            if (!this->directed && this->find_arc(update.v, update.u, &e)) {
+                this->weights[e] = update.weight;
+            }
+            if (this->reverse && this->reverse->find_arc(update.v, update.u, &e)) {
+                this->reverse->weights[e] = update.weight;
+            }
+        } else if (update.u != update.v) {
+            missing.push_back(update);
+            Edge back = {update.v, update.u, update.weight};
+            if (!this->directed) {
+                missing.push_back(back);
+            } else if (this->reverse) {
+                missingReverse.push_back(back);
+            }
+        }
+    }
+    if (!missing.empty()) {
+        this->insert_arcs(missing);
+    }
+    if (!missingReverse.empty()) {
+        this->reverse->insert_arcs(missingReverse);
+    }
+}
+
+
+// Appends new arcs to their sources' lists. Of several new arcs between the
+// same pair, the last one is kept, and dropped if it weighs DELETED_WEIGHT.
+void Graph::insert_arcs(vector<Edge> arcs) {
+    stable_sort(arcs.begin(), arcs.end(), [](const Edge &a, const Edge &b) {
+        return a.u != b.u ? a.u < b.u : a.v < b.v;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < arcs.size(); i++) {
+        if (kept > 0 && arcs[kept - 1].u == arcs[i].u && arcs[kept - 1].v == arcs[i].v) {
+            arcs[kept - 1] = arcs[i];
+        } else {
+            arcs[kept++] = arcs[i];
+        }
+    }
+    arcs.resize(kept);
+    arcs.erase(remove_if(arcs.begin(), arcs.end(), [](const Edge &arc) { return arc.weight == DELETED_WEIGHT; }),
+               arcs.end());
+    if (arcs.empty()) {
+        return;
+    }
+
+    vertex_t n = this->num_vertices;
+    GraphArray<edge_t> offsets;
+    GraphArray<vertex_t> targets;
+    GraphArray<int> weights;
+    offsets.resize((size_t) n + 1);
+    targets.resize(this->num_edges() + arcs.size());
+    weights.resize(this->num_edges() + arcs.size());
+
+    edge_t out = 0;
+    size_t next = 0;
+    for (vertex_t u = 0; u < n; u++) {
+        offsets[u] = out;
+        for (edge_t e = this->offsets[u]; e < this->offsets[u + 1]; e++, out++) {
+            targets[out] = this->targets[e];
+            weights[out] = this->weights[e];
+        }
+        for (; next < arcs.size() && arcs[next].u == u; next++, out++) {
+            targets[out] = arcs[next].v;
+            weights[out] = arcs[next].weight;
+        }
+    }
+    offsets[n] = out;
+
+    this->offsets.swap(offsets);
+    this->targets.swap(targets);
+    this->weights.swap(weights);
+}
+
+
+// Sorts every adjacency by target and keeps only the lightest of several
+// arcs to the same target. Returns the number of arcs removed.
+edge_t Graph::remove_parallel_edges(int numOfThreads) {
+    vertex_t n = this->num_vertices;
+    vector<edge_t> kept((size_t) n + 1, 0);
+    vector<thread> workers;
+
+    for (int t = 0; t < numOfThreads; t++) {
+        vertex_t first = (vertex_t) ((uint64_t) n * t / numOfThreads);
+        vertex_t last = (vertex_t) ((uint64_t) n * (t + 1) / numOfThreads);
+        workers.push_back(thread([this, &kept, first, last]() {
+            vector< pair<vertex_t, int> > adjacency;
+            for (vertex_t v = first; v < last; v++) {
+                edge_t begin = this->offsets[v];
+                edge_t end = this->offsets[v + 1];
+                adjacency.clear();
+                for (edge_t e = begin; e < end; e++) {
+                    adjacency.push_back(make_pair(this->targets[e], this->weights[e]));
+                }
+                sort(adjacency.begin(), adjacency.end());
+                // compact in place; the first arc of each run is the lightest
+                edge_t out = begin;
+                for (size_t i = 0; i < adjacency.size(); i++) {
+                    if (i > 0 && adjacency[i].first == adjacency[i - 1].first) {
+                        continue;
+                    }
+                    this->targets[out] = adjacency[i].first;
+                    this->weights[out] = adjacency[i].second;
+                    out++;
+                }
+                kept[v + 1] = out - begin;
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    for (vertex_t v = 0; v < n; v++) {
+        kept[v + 1] += kept[v];
+    }
+    edge_t removed = this->num_edges() - kept[n];
+    if (removed == 0) {
+        return 0;
+    }
+
+    GraphArray<vertex_t> targets;
+    GraphArray<int> weights;
+    targets.resize(kept[n]);
+    weights.resize(kept[n]);
+    for (vertex_t v = 0; v < n; v++) {
+        edge_t from = this->offsets[v];
+        for (edge_t e = kept[v]; e < kept[v + 1]; e++, from++) {
+            targets[e] = this->targets[from];
+            weights[e] = this->weights[from];
+        }
+    }
+    for (vertex_t v = 0; v <= n; v++) {
+        this->offsets[v] = kept[v];
+    }
+    this->targets.swap(targets);
+    this->weights.swap(weights);
+    return removed;
+}
@@ -10,27 +10,182 @@
 #include <list>
 #include <vector>
 #include <mutex>
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <utility>
+#include <limits>
 
 
 using namespace std;
 
-struct Vertex {
-    unsigned int index;
-    vector < pair <Vertex*, int> > neighbors; // Vertex + weight of edge that connect vertices
+// Vertex ids and distances are 32-bit by default; build with -DMQ_64BIT
+// (make BITS=64) for graphs past 2^32 vertices or paths longer than 2^31.
+#ifdef MQ_64BIT
+typedef uint64_t vertex_t;
+typedef int64_t dist_t;
+#else
+typedef uint32_t vertex_t;
+typedef int32_t dist_t;
+#endif
+typedef uint64_t edge_t;
+
+#define DIST_INF (std::numeric_limits<dist_t>::max())
+
+// Weight of a deleted arc. It keeps its slot in the CSR, but no path crosses
+// it: a 32-bit sum saturates at DIST_INF anyway, a 64-bit one is cut off.
+#define DELETED_WEIGHT (std::numeric_limits<int>::max())
+
+// d + weight, saturating at DIST_INF instead of wrapping around
+static inline dist_t add_dist(dist_t d, int weight) {
+#ifdef MQ_64BIT
+    if (weight == DELETED_WEIGHT) {
+        return DIST_INF;
+    }
+#endif
+    return d > DIST_INF - weight ? DIST_INF : d + weight;
+}
+
+// a + b for two distances, saturating at DIST_INF
+static inline dist_t add_dists(dist_t a, dist_t b) {
+    return a > DIST_INF - b ? DIST_INF : a + b;
+}
+
+struct Edge {
+    vertex_t u;
+    vertex_t v;
+    int weight;
+};
+
+
+// Flat array that either owns a malloc'ed block or views memory owned by
+// someone else (a mapped binary graph file). resize() does not preserve or
+// initialize contents.
+template <typename T>
+class GraphArray {
+    public:
+        GraphArray() : ptr(NULL), len(0), owned(false) {}
+        ~GraphArray() { release(); }
+
+        void resize(size_t n) {
+            release();
+            ptr = (T *) malloc((n ? n : 1) * sizeof(T));
+            if (ptr == NULL) {
+                throw std::bad_alloc();
+            }
+            len = n;
+            owned = true;
+        }
+        void assign(size_t n, const T &value) {
+            resize(n);
+            for (size_t i = 0; i < n; i++) {
+                ptr[i] = value;
+            }
+        }
+        void view(T *p, size_t n) {
+            release();
+            ptr = p;
+            len = n;
+        }
+
+        void swap(GraphArray &other) {
+            std::swap(ptr, other.ptr);
+            std::swap(len, other.len);
+            std::swap(owned, other.owned);
+        }
+
+        T &operator[](size_t i) { return ptr[i]; }
+        const T &operator[](size_t i) const { return ptr[i]; }
+        T *data() { return ptr; }
+        const T *data() const { return ptr; }
+        T *begin() { return ptr; }
+        T *end() { return ptr + len; }
+        size_t size() const { return len; }
+
+    private:
+        T *ptr;
+        size_t len;
+        bool owned;
+
+        void release() {
+            if (owned) {
+                free(ptr);
+            }
+            ptr = NULL;
+            len = 0;
+            owned = false;
+        }
+        GraphArray(const GraphArray &);
+        GraphArray &operator=(const GraphArray &);
 };
 
 
+// Compressed sparse row adjacency: the neighbors of v are
+// targets[offsets[v] .. offsets[v+1]) with the matching entries of weights.
+// An undirected graph stores every edge in both endpoints' lists; a directed
+// one stores out-arcs only and may carry its reverse, the in-arcs in the
+// same layout, for searches that run backwards.
 class Graph {
     public:
-        ~Graph(){
-            for(int i=0; i<vertices.size(); i++){
-                if(vertices[i]){
-                    delete(vertices[i]);
+        Graph() : source(0), num_vertices(0), id_base(0), directed(false), reverse(NULL), mapping(NULL),
+                  mapping_size(0) {}
+        ~Graph();
+        vertex_t source;
+        vertex_t num_vertices;
+        GraphArray <edge_t> offsets;
+        GraphArray <vertex_t> targets;
+        GraphArray <int> weights;
+        vector <vertex_t> relabel;      // relabel[file id] = id in this graph; empty when they agree
+        vertex_t id_base;               // first vertex id in the input file (1 for DIMACS and METIS)
+        bool directed;
+        Graph *reverse;                 // directed: the in-arcs, if built (adjacency only); owned
+
+        void build(vertex_t n, const vector<Edge> &edges);
+        void build(vertex_t n, const vector< vector<Edge> > &parts, bool directed = false, Graph *reverse = NULL);
+        void build_reverse(int numOfThreads);
+        edge_t remove_parallel_edges(int numOfThreads);
+        void update_arcs(const vector<Edge> &updates, vector<int> *previous);
+        void insert_arcs(vector<Edge> arcs);
+        void adopt_mapping(void *addr, size_t size);
+        edge_t num_edges() const { return targets.size(); }
+        edge_t degree(vertex_t v) const { return offsets[v + 1] - offsets[v]; }
+        // the first arc u -> v in u's list
+        bool find_arc(vertex_t u, vertex_t v, edge_t *e) const {
+            for (edge_t i = offsets[u]; i < offsets[u + 1]; i++) {
+                if (targets[i] == v) {
+                    *e = i;
+                    return true;
                 }
             }
+            return false;
+        }
+        // the graph whose lists hold the arcs into each vertex: this one when
+        // undirected, the reverse (NULL if it was not built) when directed
+        Graph *backward() { return directed ? reverse : this; }
+        // trades the arcs for those of the reverse graph (which must exist), so
+        // searches follow in-arcs: distances to the source instead of from it
+        void swap_reverse() {
+            offsets.swap(reverse->offsets);
+            targets.swap(reverse->targets);
+            weights.swap(reverse->weights);
+        }
+        // bytes held by the adjacency arrays, not counting the reverse
+        size_t memory_bytes() const {
+            return offsets.size() * sizeof(edge_t) + targets.size() * (sizeof(vertex_t) + sizeof(int));
         }
-        int source;
-        vector <Vertex*> vertices;
+        vertex_t internal_id(vertex_t file_id) const { return relabel.empty() ? file_id : relabel[file_id]; }
+        // translates an id as written in the input file; false if there is no such vertex
+        bool from_file_id(uint64_t id, vertex_t *v) const {
+            if (id < id_base || id - id_base >= num_vertices) {
+                return false;
+            }
+            *v = internal_id((vertex_t) (id - id_base));
+            return true;
+        }
+
+    private:
+        void *mapping;          // binary graph file backing the arrays, if any
+        size_t mapping_size;
 
 };
 
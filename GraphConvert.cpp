@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <getopt.h>
+#include "Graph.h"
+#include "GraphLoader.h"
+
+using namespace std;
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " [-f format] [-s source] [-D] <graph file> <binary graph file>" << endl
+         << "  -D, --directed  keep arcs as given; the binary graph is marked directed" << endl;
+}
+
+// One-time conversion of a text graph (any format load_graph reads) into the
+// binary graph format, which MultiQueues then maps instead of parsing.
+int main(int argc, char *argv[]) {
+
+    LoadOptions loadOptions;
+    loadOptions.numOfThreads = thread::hardware_concurrency();
+
+    static struct option longOptions[] = {
+        {"format", required_argument, NULL, 'f'},
+        {"source", required_argument, NULL, 's'},
+        {"directed", no_argument, NULL, 'D'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:s:D", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                if (!parse_graph_format(optarg, &loadOptions.format)) {
+                    cerr << "Unknown graph format " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 's':
+                loadOptions.source = atoll(optarg);
+                break;
+            case 'D':
+                loadOptions.directed = true;
+                break;
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+    if (argc - optind < 2) {
+        usage(argv[0]);
+        exit(1);
+    }
+    string input = argv[optind];
+    string output = argv[optind + 1];
+
+    Graph *G = new Graph();
+    if (!load_graph(input, G, loadOptions)) {
+        cerr << "Unable to load graph " + input << endl;
+        exit(1);
+    }
+    if (!save_binary_graph(output, *G)) {
+        cerr << "Unable to write file " + output << endl;
+        exit(1);
+    }
+    delete G;
+
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <getopt.h>
+#include <stdlib.h>
+#include "Graph.h"
+#include "GraphLoader.h"
+#include "Generator.h"
+
+using namespace std;
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " [-f format] [-s source] [-D] [-t threads] <model[:key=value,...]> <output file>" << endl
+         << "  -f, --format <name>   binary (default), edgelist or dimacs" << endl
+         << "  -D, --directed        keep arcs as drawn; the output is a directed graph" << endl
+         << "  -t, --threads <n>     generator threads (default: hardware concurrency)" << endl
+         << "models: rmat, grid2d, grid3d, geometric, er; keys: n, scale, degree, weights (uniform, log," << endl
+         << "constant, euclidean), min, max, seed, and a, b, c for rmat" << endl;
+}
+
+// Writes a synthetic graph in a format MultiQueues loads, for benchmarks
+// that should not depend on downloaded data.
+int main(int argc, char *argv[]) {
+
+    GeneratorOptions options;
+    options.numOfThreads = max((int) thread::hardware_concurrency(), 1);
+    GraphFormat format = FORMAT_BINARY;
+
+    static struct option longOptions[] = {
+        {"format", required_argument, NULL, 'f'},
+        {"source", required_argument, NULL, 's'},
+        {"directed", no_argument, NULL, 'D'},
+        {"threads", required_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:s:Dt:", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                if (!parse_graph_format(optarg, &format) ||
+                    (format != FORMAT_BINARY && format != FORMAT_EDGE_LIST && format != FORMAT_DIMACS)) {
+                    cerr << "Graphs are written as binary, edgelist or dimacs, not " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 's':
+                options.source = atoll(optarg);
+                break;
+            case 'D':
+                options.directed = true;
+                break;
+            case 't':
+                options.numOfThreads = atoi(optarg);
+                if (options.numOfThreads < 1) {
+                    cerr << "The number of threads must be positive" << endl;
+                    exit(1);
+                }
+                break;
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+    if (argc - optind < 2) {
+        usage(argv[0]);
+        exit(1);
+    }
+    string output = argv[optind + 1];
+    if (!parse_generator_spec(argv[optind], &options)) {
+        exit(1);
+    }
+
+    Graph *G = new Graph();
+    if (!generate_graph(options, G)) {
+        exit(1);
+    }
+    bool ok = format == FORMAT_BINARY ? save_binary_graph(output, *G) :
+              save_text_graph(output, *G, format, options.numOfThreads);
+    if (!ok) {
+        cerr << "Unable to write file " + output << endl;
+        exit(1);
+    }
+    delete G;
+
+}
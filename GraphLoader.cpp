@@ -0,0 +1,680 @@
+#include "GraphLoader.h"
+#include "Parallel.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+
+static inline const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+static inline const char *skip_line(const char *p, const char *end) {
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+// Reads an unsigned decimal at p (after leading blanks), saturating at
+// UINT64_MAX. Returns the first character past it, or NULL when there is no
+// number there.
+static inline const char *scan_uint(const char *p, const char *end, uint64_t *out) {
+    p = skip_blanks(p, end);
+    if (p == end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+    uint64_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value > (UINT64_MAX - 9) / 10 ? UINT64_MAX : value * 10 + (*p - '0');
+        p++;
+    }
+    *out = value;
+    return p;
+}
+
+
+struct ParseChunk {
+    const char *begin;
+    const char *end;
+    uint64_t num_vertices;  // ids at or above this are rejected
+    uint64_t first_line;    // METIS: vertex described by the chunk's first line
+    uint64_t lines;         // METIS: vertex lines in the chunk
+    uint64_t max_id;        // SNAP: largest id seen, the vertex count is not declared
+    int metis_fmt;
+    int metis_ncon;
+    bool directed;          // METIS: keep both copies of every edge
+    vector<Edge> edges;
+    size_t skipped;
+    size_t loops;
+    size_t heavy;           // edges weighing DELETED_WEIGHT or more, which fail the load
+};
+
+typedef void (*ChunkParser)(ParseChunk *);
+
+// first character of the line at p, '\n' for a blank line
+static inline char line_start(const char *p, const char *end) {
+    p = skip_blanks(p, end);
+    return p < end ? *p : '\n';
+}
+
+static inline bool is_blank_line(const char *p, const char *end) {
+    return line_start(p, end) == '\n';
+}
+
+static inline void add_edge(ParseChunk *chunk, uint64_t u, uint64_t v, uint64_t w) {
+    if (u == v) {
+        chunk->loops++;
+        return;
+    }
+    if (w >= (uint64_t) DELETED_WEIGHT) {
+        chunk->heavy++;
+        return;
+    }
+    Edge edge;
+    edge.u = (vertex_t) u;
+    edge.v = (vertex_t) v;
+    edge.weight = (int) w;
+    chunk->edges.push_back(edge);
+}
+
+// "u v w", 0-based
+static void parse_edge_list_chunk(ParseChunk *chunk) {
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+
+    while (p < end) {
+        uint64_t u, v, w;
+        const char *q = scan_uint(p, end, &u);
+        if (q) q = scan_uint(q, end, &v);
+        if (q) q = scan_uint(q, end, &w);
+
+        if (q && u < chunk->num_vertices && v < chunk->num_vertices) {
+            add_edge(chunk, u, v, w);
+        } else if (!is_blank_line(p, end)) {
+            chunk->skipped++;
+        }
+        p = skip_line(q ? q : p, end);
+    }
+}
+
+// "a u v w", 1-based; comment ('c') and problem ('p') lines are ignored
+static void parse_dimacs_chunk(ParseChunk *chunk) {
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+
+    while (p < end) {
+        const char *q = skip_blanks(p, end);
+        if (q < end && *q == 'a') {
+            uint64_t u, v, w;
+            q = scan_uint(q + 1, end, &u);
+            if (q) q = scan_uint(q, end, &v);
+            if (q) q = scan_uint(q, end, &w);
+            if (q && u >= 1 && v >= 1 && u <= chunk->num_vertices && v <= chunk->num_vertices) {
+                add_edge(chunk, u - 1, v - 1, w);
+            } else {
+                chunk->skipped++;
+            }
+        } else if (q < end && *q != 'c' && *q != 'p' && *q != '\n') {
+            chunk->skipped++;
+        }
+        p = skip_line(q ? q : p, end);
+    }
+}
+
+// "u v [w]", 0-based, unweighted edges get weight 1; '#' and '%' lines are comments
+static void parse_snap_chunk(ParseChunk *chunk) {
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+    chunk->max_id = 0;
+
+    while (p < end) {
+        const char *q = skip_blanks(p, end);
+        if (q < end && (*q == '#' || *q == '%')) {
+            p = skip_line(q, end);
+            continue;
+        }
+        uint64_t u, v, w = 1;
+        q = scan_uint(q, end, &u);
+        if (q) q = scan_uint(q, end, &v);
+        if (q) {
+            const char *r = scan_uint(q, end, &w);
+            q = r ? r : q;
+        }
+        if (q && u < chunk->num_vertices && v < chunk->num_vertices) {
+            add_edge(chunk, u, v, w);
+            chunk->max_id = max(chunk->max_id, max(u, v));
+        } else if (!is_blank_line(p, end)) {
+            chunk->skipped++;
+        }
+        p = skip_line(q ? q : p, end);
+    }
+}
+
+// first pass over a METIS body: vertex lines are numbered, so each chunk has
+// to know how many lines precede it
+static void count_metis_lines(ParseChunk *chunk) {
+    const char *p = chunk->begin;
+    chunk->lines = 0;
+    while (p < chunk->end) {
+        const char *q = skip_blanks(p, chunk->end);
+        if (q == chunk->end || *q != '%') {
+            chunk->lines++;
+        }
+        p = skip_line(p, chunk->end);
+    }
+}
+
+// line i lists "[size] [weights...] v1 [w1] v2 [w2] ..." for vertex i, 1-based.
+// Every edge appears on both endpoints' lines; only the u < v copy is kept,
+// unless the graph is read as directed, where each entry is an arc.
+static void parse_metis_chunk(ParseChunk *chunk) {
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+    uint64_t u = chunk->first_line;
+    bool has_size = (chunk->metis_fmt / 100) % 10 == 1;
+    bool has_vertex_weights = (chunk->metis_fmt / 10) % 10 == 1;
+    bool has_edge_weights = chunk->metis_fmt % 10 == 1;
+
+    while (p < end) {
+        const char *q = skip_blanks(p, end);
+        if (q < end && *q == '%') {
+            p = skip_line(q, end);
+            continue;
+        }
+        if (u >= chunk->num_vertices) {
+            if (!is_blank_line(p, end)) {
+                chunk->skipped++;
+            }
+            p = skip_line(p, end);
+            u++;
+            continue;
+        }
+
+        uint64_t ignored;
+        int header_values = (has_size ? 1 : 0) + (has_vertex_weights ? chunk->metis_ncon : 0);
+        for (int k = 0; k < header_values && q; k++) {
+            q = scan_uint(q, end, &ignored);
+        }
+        while (q) {
+            uint64_t v, w = 1;
+            const char *r = scan_uint(q, end, &v);
+            if (!r) {
+                break;
+            }
+            if (has_edge_weights) {
+                r = scan_uint(r, end, &w);
+                if (!r) {
+                    chunk->skipped++;
+                    break;
+                }
+            }
+            q = r;
+            if (v < 1 || v > chunk->num_vertices) {
+                chunk->skipped++;
+            } else if (u < v - 1 || (chunk->directed && u != v - 1)) {
+                add_edge(chunk, u, v - 1, w);
+            } else if (u == v - 1) {
+                chunk->loops++;
+            }
+        }
+        p = skip_line(p, end);
+        u++;
+    }
+}
+
+
+// Cuts [begin, end) into chunks that start right after a newline and end on one.
+static void split_chunks(const char *begin, const char *end, vector<ParseChunk> &chunks) {
+    size_t body = end - begin;
+    size_t parts = chunks.size();
+    const char *cut = begin;
+    for (size_t t = 0; t < parts; t++) {
+        chunks[t].begin = cut;
+        cut = (t == parts - 1) ? end : skip_line(max(cut, begin + body * (t + 1) / parts - 1), end);
+        chunks[t].end = cut;
+        chunks[t].skipped = 0;
+        chunks[t].loops = 0;
+        chunks[t].heavy = 0;
+    }
+}
+
+static void run_chunks(vector<ParseChunk> &chunks, ChunkParser parse) {
+    vector<thread> workers;
+    for (size_t t = 1; t < chunks.size(); t++) {
+        workers.push_back(thread(parse, &chunks[t]));
+    }
+    parse(&chunks[0]);
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+
+bool parse_graph_format(const std::string &name, GraphFormat *format) {
+    if (name == "auto") {
+        *format = FORMAT_AUTO;
+    } else if (name == "edgelist") {
+        *format = FORMAT_EDGE_LIST;
+    } else if (name == "dimacs") {
+        *format = FORMAT_DIMACS;
+    } else if (name == "snap") {
+        *format = FORMAT_SNAP;
+    } else if (name == "metis") {
+        *format = FORMAT_METIS;
+    } else if (name == "binary") {
+        *format = FORMAT_BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool has_suffix(const std::string &s, const char *suffix) {
+    size_t len = strlen(suffix);
+    return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+}
+
+static GraphFormat guess_text_format(const std::string &path, const char *data, const char *end) {
+    if (has_suffix(path, ".gr")) {
+        return FORMAT_DIMACS;
+    }
+    if (has_suffix(path, ".graph") || has_suffix(path, ".metis")) {
+        return FORMAT_METIS;
+    }
+    const char *p = skip_blanks(data, end);
+    if (p < end && *p == '#') {
+        return FORMAT_SNAP;
+    }
+    return FORMAT_EDGE_LIST;
+}
+
+
+static inline size_t align8(size_t bytes) {
+    return (bytes + 7) & ~(size_t) 7;
+}
+
+
+void report_graph_memory(const Graph *G) {
+    cout << (G->directed ? "directed" : "undirected") << " graph, adjacency " << G->memory_bytes() / 1e6 << " MB";
+    if (G->reverse) {
+        cout << " + reverse " << G->reverse->memory_bytes() / 1e6 << " MB";
+    }
+    cout << endl;
+}
+
+
+// The engines index with a mapped graph's arrays unchecked: offsets must run
+// from 0 to m without decreasing, targets must be vertices and weights must be
+// in [0, DELETED_WEIGHT). Prints what is wrong, if anything.
+static bool check_binary_graph(const edge_t *offsets, const vertex_t *targets, const int *weights, size_t n,
+                               size_t m, int numOfThreads) {
+    if (offsets[0] != 0 || offsets[n] != m) {
+        cerr << "corrupt binary graph: offsets run from " << offsets[0] << " to " << offsets[n] << ", not 0 to "
+             << m << endl;
+        return false;
+    }
+    vector<char> bad_offsets(numOfThreads, 0);
+    vector<char> bad_arcs(numOfThreads, 0);
+    for_each_slice(n, numOfThreads, [offsets, &bad_offsets](int t, size_t first, size_t last) {
+        for (size_t v = first; v < last; v++) {
+            bad_offsets[t] |= offsets[v] > offsets[v + 1];
+        }
+    });
+    for_each_slice(m, numOfThreads, [targets, weights, n, &bad_arcs](int t, size_t first, size_t last) {
+        for (size_t e = first; e < last; e++) {
+            bad_arcs[t] |= targets[e] >= n || weights[e] < 0 || weights[e] >= DELETED_WEIGHT;
+        }
+    });
+    for (int t = 0; t < numOfThreads; t++) {
+        if (bad_offsets[t]) {
+            cerr << "corrupt binary graph: offsets decrease" << endl;
+            return false;
+        }
+        if (bad_arcs[t]) {
+            cerr << "corrupt binary graph: arc targets or weights out of range" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Points G's arrays into a mapped binary graph, once checked, and hands it
+// the mapping.
+static bool map_binary_graph(char *data, size_t size, Graph *G, int numOfThreads) {
+    BinaryGraphHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != BINARY_GRAPH_VERSION || header.offset_bytes != sizeof(edge_t) ||
+        header.vertex_bytes != sizeof(vertex_t) || header.weight_bytes != sizeof(int) ||
+        header.source >= header.num_vertices || header.num_vertices > numeric_limits<vertex_t>::max()) {
+        cerr << "unsupported binary graph (version " << header.version << ", "
+             << header.vertex_bytes * 8 << "-bit vertex ids)" << endl;
+        return false;
+    }
+    size_t n = header.num_vertices;
+    size_t m = header.num_arcs;
+    if (n >= size / sizeof(edge_t) || m > size / sizeof(int)) {
+        cerr << "truncated binary graph" << endl;
+        return false;
+    }
+    size_t off = align8(sizeof(header));
+    size_t tgt = off + align8((n + 1) * sizeof(edge_t));
+    size_t wgt = tgt + align8(m * sizeof(vertex_t));
+    if (wgt + m * sizeof(int) > size) {
+        cerr << "truncated binary graph" << endl;
+        return false;
+    }
+    if (!check_binary_graph((edge_t *) (data + off), (vertex_t *) (data + tgt), (int *) (data + wgt), n, m,
+                            numOfThreads)) {
+        return false;
+    }
+
+    G->source = (vertex_t) header.source;
+    G->num_vertices = (vertex_t) n;
+    G->id_base = (vertex_t) header.id_base;
+    G->directed = (header.flags & BINARY_GRAPH_DIRECTED) != 0;
+    G->offsets.view((edge_t *) (data + off), n + 1);
+    G->targets.view((vertex_t *) (data + tgt), m);
+    G->weights.view((int *) (data + wgt), m);
+    G->adopt_mapping(data, size);
+    return true;
+}
+
+
+bool load_graph(const std::string &path, Graph *G, const LoadOptions &options) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    // private writable mapping: a binary graph may be modified in place
+    // (copy-on-write) without touching the file
+    char *data = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    bool binary = size >= sizeof(BinaryGraphHeader) && memcmp(data, BINARY_GRAPH_MAGIC, sizeof(BINARY_GRAPH_MAGIC)) == 0;
+    if (binary || options.format == FORMAT_BINARY) {
+        if (!binary || !map_binary_graph(data, size, G, max(options.numOfThreads, 1))) {
+            munmap(data, size);
+            return false;
+        }
+        if (options.source >= 0) {
+            if ((uint64_t) options.source < G->id_base || (uint64_t) options.source - G->id_base >= G->num_vertices) {
+                return false;
+            }
+            G->source = (vertex_t) (options.source - G->id_base);
+        }
+        if (G->directed && options.reverse) {
+            G->build_reverse(max(options.numOfThreads, 1));
+            G->reverse->remove_parallel_edges(max(options.numOfThreads, 1));
+            G->reverse->source = G->source;
+        }
+        double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "mapped " << G->num_vertices << " vertices, " << G->num_edges() << " arcs in "
+             << total_s << " s" << endl;
+        report_graph_memory(G);
+        return true;
+    }
+
+    madvise(data, size, MADV_SEQUENTIAL);
+    const char *end = data + size;
+    GraphFormat format = options.format == FORMAT_AUTO ? guess_text_format(path, data, end) : options.format;
+
+    // header; p ends up at the first body line
+    uint64_t n = 0, m = 0, source = 0;
+    uint64_t fmt = 0, ncon = 1;
+    bool one_based = format == FORMAT_DIMACS || format == FORMAT_METIS;
+    const char *p = data;
+    if (format == FORMAT_EDGE_LIST) {
+        p = scan_uint(p, end, &n);
+        if (p) p = scan_uint(p, end, &m);
+        if (p) p = scan_uint(p, end, &source);
+    } else if (format == FORMAT_DIMACS) {
+        while (p < end && line_start(p, end) != 'p') {
+            p = skip_line(p, end);
+        }
+        p = skip_blanks(p, end);
+        if (p < end) {
+            p = skip_blanks(p + 1, end);
+            while (p < end && *p >= 'a' && *p <= 'z') {     // problem type, "sp"
+                p++;
+            }
+            p = scan_uint(p, end, &n);
+            if (p) p = scan_uint(p, end, &m);
+        }
+    } else if (format == FORMAT_METIS) {
+        while (p < end && line_start(p, end) == '%') {
+            p = skip_line(p, end);
+        }
+        p = scan_uint(p, end, &n);
+        if (p) p = scan_uint(p, end, &m);
+        const char *q = p ? scan_uint(p, end, &fmt) : NULL;
+        if (q) {
+            scan_uint(q, end, &ncon);
+        }
+    } else {
+        n = numeric_limits<vertex_t>::max();    // upper bound until the ids have been seen
+    }
+    if (!p || n > numeric_limits<vertex_t>::max()) {
+        cerr << (p ? "too many vertices for this build, rebuild with BITS=64" : "malformed graph header") << endl;
+        munmap(data, size);
+        return false;
+    }
+    if (format != FORMAT_SNAP) {
+        p = skip_line(p, end);
+    }
+
+    int numOfThreads = max(options.numOfThreads, 1);
+    vector<ParseChunk> chunks(numOfThreads);
+    split_chunks(p, end, chunks);
+    for (int t = 0; t < numOfThreads; t++) {
+        chunks[t].num_vertices = n;
+        chunks[t].metis_fmt = (int) fmt;
+        chunks[t].metis_ncon = (int) ncon;
+        chunks[t].directed = options.directed;
+        chunks[t].edges.reserve(m / numOfThreads + 1);
+    }
+
+    if (format == FORMAT_EDGE_LIST) {
+        run_chunks(chunks, parse_edge_list_chunk);
+    } else if (format == FORMAT_DIMACS) {
+        run_chunks(chunks, parse_dimacs_chunk);
+    } else if (format == FORMAT_SNAP) {
+        run_chunks(chunks, parse_snap_chunk);
+    } else {
+        run_chunks(chunks, count_metis_lines);
+        uint64_t line = 0;
+        for (int t = 0; t < numOfThreads; t++) {
+            chunks[t].first_line = line;
+            line += chunks[t].lines;
+        }
+        run_chunks(chunks, parse_metis_chunk);
+    }
+    munmap(data, size);
+
+    chrono::steady_clock::time_point parsed = chrono::steady_clock::now();
+
+    vector< vector<Edge> > parts(numOfThreads);
+    size_t skipped = 0, loops = 0, heavy = 0;
+    uint64_t max_id = 0;
+    for (int t = 0; t < numOfThreads; t++) {
+        parts[t].swap(chunks[t].edges);
+        skipped += chunks[t].skipped;
+        loops += chunks[t].loops;
+        heavy += chunks[t].heavy;
+        max_id = max(max_id, chunks[t].max_id);
+    }
+    if (heavy) {
+        cerr << heavy << " edges weigh " << DELETED_WEIGHT << " or more, the largest weight is "
+             << DELETED_WEIGHT - 1 << endl;
+        return false;
+    }
+    if (format == FORMAT_SNAP) {
+        n = max_id + 1;
+    }
+
+    if (format != FORMAT_EDGE_LIST) {
+        source = options.source >= 0 ? options.source - (one_based ? 1 : 0) : 0;
+    } else if (options.source >= 0) {
+        source = options.source;
+    }
+    if (source >= n) {
+        cerr << "source vertex is out of range" << endl;
+        return false;
+    }
+    G->source = (vertex_t) source;
+    G->id_base = one_based ? 1 : 0;
+
+    G->build((vertex_t) n, parts, options.directed, options.directed && options.reverse ? new Graph() : NULL);
+    parts.clear();
+    edge_t parallel = G->remove_parallel_edges(numOfThreads);
+    if (G->reverse) {
+        G->reverse->remove_parallel_edges(numOfThreads);
+    }
+
+    chrono::steady_clock::time_point built = chrono::steady_clock::now();
+    double parse_s = chrono::duration<double>(parsed - start).count();
+    double total_s = chrono::duration<double>(built - start).count();
+
+    if (skipped) {
+        cerr << "skipped " << skipped << " malformed or out-of-range lines or entries" << endl;
+    }
+    if (loops || parallel) {
+        cout << "dropped " << loops << " self-loops and " << parallel << " parallel arcs" << endl;
+    }
+    cout << "loaded " << n << " vertices, " << G->num_edges() << " arcs in " << total_s << " s ("
+         << "parse " << parse_s << " s, " << (size / 1e6) / parse_s << " MB/s, "
+         << numOfThreads << " threads)" << endl;
+    report_graph_memory(G);
+    return true;
+}
+
+
+bool save_binary_graph(const std::string &path, const Graph &G) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    BinaryGraphHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(BINARY_GRAPH_MAGIC));
+    header.version = BINARY_GRAPH_VERSION;
+    header.flags = G.directed ? BINARY_GRAPH_DIRECTED : 0;
+    header.num_vertices = G.num_vertices;
+    header.num_arcs = G.num_edges();
+    header.source = G.source;
+    header.offset_bytes = sizeof(edge_t);
+    header.vertex_bytes = sizeof(vertex_t);
+    header.weight_bytes = sizeof(int);
+    header.id_base = G.id_base;
+
+    static const char padding[8] = {0};
+    size_t n = G.num_vertices;
+    size_t m = G.num_edges();
+    size_t offsets_bytes = (n + 1) * sizeof(edge_t);
+    size_t targets_bytes = m * sizeof(vertex_t);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(padding, 1, align8(sizeof(header)) - sizeof(header), f) == align8(sizeof(header)) - sizeof(header) &&
+              fwrite(G.offsets.data(), 1, offsets_bytes, f) == offsets_bytes &&
+              fwrite(padding, 1, align8(offsets_bytes) - offsets_bytes, f) == align8(offsets_bytes) - offsets_bytes &&
+              fwrite(G.targets.data(), 1, targets_bytes, f) == targets_bytes &&
+              fwrite(padding, 1, align8(targets_bytes) - targets_bytes, f) == align8(targets_bytes) - targets_bytes &&
+              fwrite(G.weights.data(), sizeof(int), m, f) == m;
+    return fclose(f) == 0 && ok;
+}
+
+
+static inline void append_uint(string &out, uint64_t value) {
+    char digits[20];
+    size_t k = 0;
+    do {
+        digits[k++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (k) {
+        out.push_back(digits[--k]);
+    }
+}
+
+
+bool save_text_graph(const std::string &path, const Graph &G, GraphFormat format, int numOfThreads) {
+    if (format != FORMAT_EDGE_LIST && format != FORMAT_DIMACS) {
+        return false;
+    }
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    // an undirected edge list lists every edge once, from its smaller end
+    bool once = format == FORMAT_EDGE_LIST && !G.directed;
+    uint64_t base = format == FORMAT_DIMACS ? 1 : 0;
+    uint64_t lines = once ? G.num_edges() / 2 : G.num_edges();
+    bool ok;
+    if (format == FORMAT_DIMACS) {
+        ok = fprintf(f, "p sp %llu %llu\n", (unsigned long long) G.num_vertices, (unsigned long long) lines) > 0;
+    } else {
+        ok = fprintf(f, "%llu %llu %llu\n", (unsigned long long) G.num_vertices, (unsigned long long) lines,
+                     (unsigned long long) G.source) > 0;
+    }
+
+    // rounds of numOfThreads slices bound the memory of the formatted text
+    numOfThreads = max(numOfThreads, 1);
+    vector<string> slices(numOfThreads);
+    size_t round = (size_t) numOfThreads << 16;
+    for (size_t first = 0; ok && first < G.num_vertices; first += round) {
+        size_t last = min(first + round, (size_t) G.num_vertices);
+        vector<thread> workers;
+        for (int t = 0; t < numOfThreads; t++) {
+            workers.push_back(thread([&G, &slices, t, first, last, numOfThreads, once, base, format]() {
+                string &out = slices[t];
+                out.clear();
+                vertex_t begin = (vertex_t) (first + (last - first) * t / numOfThreads);
+                vertex_t end = (vertex_t) (first + (last - first) * (t + 1) / numOfThreads);
+                for (vertex_t u = begin; u < end; u++) {
+                    for (edge_t e = G.offsets[u]; e < G.offsets[u + 1]; e++) {
+                        if (once && G.targets[e] < u) {
+                            continue;
+                        }
+                        if (format == FORMAT_DIMACS) {
+                            out += "a ";
+                        }
+                        append_uint(out, u + base);
+                        out.push_back(' ');
+                        append_uint(out, G.targets[e] + base);
+                        out.push_back(' ');
+                        append_uint(out, G.weights[e]);
+                        out.push_back('\n');
+                    }
+                }
+            }));
+        }
+        for (int t = 0; t < numOfThreads; t++) {
+            workers[t].join();
+        }
+        for (int t = 0; ok && t < numOfThreads; t++) {
+            ok = fwrite(slices[t].data(), 1, slices[t].size(), f) == slices[t].size();
+        }
+    }
+    return fclose(f) == 0 && ok;
+}
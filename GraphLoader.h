@@ -0,0 +1,74 @@
+#ifndef MULTIQUEUE_GRAPHLOADER_H
+#define MULTIQUEUE_GRAPHLOADER_H
+
+#include <string>
+#include "Graph.h"
+
+#define BINARY_GRAPH_MAGIC "MQGRAPH"
+#define BINARY_GRAPH_VERSION 2       // 2: the input's id base
+#define BINARY_GRAPH_DIRECTED 1     // arcs are stored once, from their tail
+
+// On-disk layout of a binary graph: this header, then offsets[num_vertices + 1],
+// targets[num_arcs] and weights[num_arcs], each section starting on an 8-byte
+// boundary. Arrays are stored in host byte order with the widths recorded
+// below, so the file can be mapped and used in place.
+struct BinaryGraphHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;             // BINARY_GRAPH_DIRECTED or 0
+    uint64_t num_vertices;
+    uint64_t num_arcs;
+    uint64_t source;
+    uint32_t offset_bytes;      // sizeof(edge_t)
+    uint32_t vertex_bytes;      // sizeof(vertex_t)
+    uint32_t weight_bytes;      // sizeof(int)
+    uint32_t id_base;           // first vertex id of the input file (1 for DIMACS and METIS)
+};
+
+enum GraphFormat {
+    FORMAT_AUTO,        // binary by magic, otherwise by file extension
+    FORMAT_EDGE_LIST,   // "n m source" header, then "u v w" per edge, 0-based
+    FORMAT_DIMACS,      // DIMACS shortest path .gr: "p sp n m", "a u v w", 1-based arcs
+    FORMAT_SNAP,        // SNAP edge list: '#' comments, "u v [w]", 0-based arcs
+    FORMAT_METIS,       // METIS: "n m [fmt [ncon]]", then line i lists the neighbors of i, 1-based
+    FORMAT_BINARY
+};
+
+struct LoadOptions {
+    GraphFormat format;
+    int64_t source;         // in the file's own numbering; -1 takes the header's (or the first vertex)
+    int numOfThreads;
+    bool directed;          // keep every arc (or METIS entry) as given instead of symmetrizing
+    bool reverse;           // directed: also build G->reverse
+
+    LoadOptions() : format(FORMAT_AUTO), source(-1), numOfThreads(1), directed(false), reverse(false) {}
+};
+
+// Parses a format name ("edgelist", "dimacs", "snap", "metis", "binary",
+// "auto"). Returns false for anything else.
+bool parse_graph_format(const std::string &name, GraphFormat *format);
+
+// Loads path into G. A binary graph (see above) is mapped and used in place.
+// Text formats are memory mapped, cut into numOfThreads chunks at line
+// boundaries and parsed in parallel. Self-loops are dropped while parsing and
+// parallel edges are collapsed to the lightest one. Unless options.directed
+// is set, every edge or arc is symmetrized into an undirected graph; a binary
+// graph is directed if it was saved from a directed one, whatever the
+// options say. The reverse graph of a directed text graph is filled in the
+// same pass as the graph. Returns false if the file cannot be opened or is
+// malformed.
+bool load_graph(const std::string &path, Graph *G, const LoadOptions &options);
+
+// Prints the adjacency size of G and of its reverse, if built.
+void report_graph_memory(const Graph *G);
+
+// Writes G in the binary format. Returns false on I/O failure.
+bool save_binary_graph(const std::string &path, const Graph &G);
+
+// Writes G as an edge list ("n m source", then "u v w", each undirected edge
+// once) or in DIMACS ("p sp n m", then "a u v w", 1-based, both arcs of an
+// undirected edge). numOfThreads threads format slices of vertices that are
+// written in order. Returns false on I/O failure or another format.
+bool save_text_graph(const std::string &path, const Graph &G, GraphFormat format, int numOfThreads);
+
+#endif //MULTIQUEUE_GRAPHLOADER_H
@@ -3,32 +3,110 @@
 //
 
 #include "Heap.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
 
 
-Heap::Heap(int capacity, int d) {
+Heap::Heap(int capacity, int d, bool huge_pages) {
+    if (capacity < HEAP_MIN_CAPACITY) {
+        capacity = HEAP_MIN_CAPACITY;
+    }
     this->heap_size = 0;
     this->d = d;
-    this->elements = new Offer*[capacity];
-    this->capacity = capacity;
-    for (int i=0; i<this->capacity; i++){
-        this->elements[i] = NULL;
-    }
+    this->elements = NULL;
+    this->capacity = 0;
+    this->initial_capacity = capacity;
+    this->mapped = false;
+    this->huge_pages = huge_pages;
+    // slots past heap_size are never read, so the array is left uninitialized
+    this->resize(capacity);
 }
 
 
-void Heap::increase_size() {
-    this->capacity = this->capacity * 2;
-    Offer** newArray = new Offer*[this->capacity];
-    for (int i=0; i<this->capacity; i++){
-        newArray[i] = NULL;
+size_t Heap::mapped_bytes(int capacity) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t bytes = (size_t) capacity * sizeof(Offer*);
+    return (bytes + page - 1) / page * page;
+}
+
+
+void Heap::resize(int new_capacity) {
+    size_t bytes = (size_t) new_capacity * sizeof(Offer*);
+    bool want_mapped = bytes >= HEAP_MMAP_THRESHOLD;
+    Offer** newArray;
+
+    if (want_mapped && this->mapped) {
+        newArray = (Offer**) mremap(this->elements, mapped_bytes(this->capacity),
+                                    mapped_bytes(new_capacity), MREMAP_MAYMOVE);
+        if (newArray == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+    } else if (!want_mapped && !this->mapped) {
+        newArray = (Offer**) realloc(this->elements, bytes);
+        if (newArray == NULL) {
+            throw std::bad_alloc();
+        }
+    } else {
+        // crossing the mmap threshold: only the live prefix has to move
+        if (want_mapped) {
+            newArray = (Offer**) mmap(NULL, mapped_bytes(new_capacity), PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (newArray == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+        } else {
+            newArray = (Offer**) malloc(bytes);
+            if (newArray == NULL) {
+                throw std::bad_alloc();
+            }
+        }
+        if (this->elements) {
+            memcpy(newArray, this->elements, (size_t) this->heap_size * sizeof(Offer*));
+            if (this->mapped) {
+                munmap(this->elements, mapped_bytes(this->capacity));
+            } else {
+                ::free(this->elements);
+            }
+        }
     }
-    for(int i=0; i < this->capacity / 2; i++) {
-        newArray[i] = this->elements[i];
+
+#ifdef MADV_HUGEPAGE
+    if (want_mapped && this->huge_pages && bytes >= HEAP_HUGE_PAGE_SIZE) {
+        madvise(newArray, mapped_bytes(new_capacity), MADV_HUGEPAGE);
     }
-    delete [] this->elements;
+#endif
+
     this->elements = newArray;
+    this->capacity = new_capacity;
+    this->mapped = want_mapped;
+}
+
+
+void Heap::increase_size() {
+    this->resize(this->capacity * 2);
+}
+
+
+// Give memory back once a grown queue has drained to a quarter of its capacity.
+// Halving (rather than shrinking to fit) leaves room so the next burst of
+// inserts does not immediately grow it again.
+void Heap::shrink_if_sparse() {
+    if (this->capacity > this->initial_capacity && this->heap_size <= this->capacity / 4) {
+        int new_capacity = this->capacity / 2;
+        if (new_capacity < this->initial_capacity) {
+            new_capacity = this->initial_capacity;
+        }
+        this->resize(new_capacity);
+    }
 }
 
 Heap::~Heap() {
-    delete [] this->elements;
-}
\ No newline at end of file
+    if (this->mapped) {
+        munmap(this->elements, mapped_bytes(this->capacity));
+    } else {
+        ::free(this->elements);
+    }
+}
@@ -6,18 +6,31 @@
 #define MULTIQUEUE_HEAP_H
 
 #include <climits>
+#include <cstddef>
 #include "Graph.h"
 
+#define HEAP_MIN_CAPACITY 64
+#define HEAP_MMAP_THRESHOLD (1 << 20)       // bytes; smaller arrays live on the malloc heap
+#define HEAP_HUGE_PAGE_SIZE (1 << 21)
+
 
 class Heap {
     public:
-        Heap(int capacity, int d);
+        Heap(int capacity, int d, bool huge_pages = false);
         struct Offer** elements;
         int d;
         int heap_size;
         int capacity;
         ~Heap();
         void increase_size();
+        void shrink_if_sparse();
+
+    private:
+        int initial_capacity;
+        bool mapped;        // elements is an anonymous mapping rather than a malloc block
+        bool huge_pages;
+        void resize(int new_capacity);
+        static size_t mapped_bytes(int capacity);
 };
 
 
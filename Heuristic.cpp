@@ -0,0 +1,124 @@
+#include "Heuristic.h"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+
+bool parse_heuristic(const std::string &name, HeuristicKind *kind) {
+    if (name == "none") {
+        *kind = HEURISTIC_NONE;
+    } else if (name == "euclidean") {
+        *kind = HEURISTIC_EUCLIDEAN;
+    } else if (name == "haversine") {
+        *kind = HEURISTIC_HAVERSINE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+bool Heuristic::load(const std::string &path, const Graph *G, HeuristicKind kind, int numOfThreads) {
+    FILE *f = fopen(path.c_str(), "r");
+    if (f == NULL) {
+        cerr << "Unable to open file " << path << endl;
+        return false;
+    }
+
+    vertex_t n = G->num_vertices;
+    this->kind = kind;
+    this->px.assign(n, 0);
+    this->py.assign(n, 0);
+    this->pz.clear();
+    vector<bool> seen(n, false);
+    vertex_t count = 0;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0' || *p == '\n' || *p == 'c' || *p == 'p' || *p == '#') {
+            continue;
+        }
+        bool dimacs = *p == 'v';
+        if (dimacs) {
+            p++;
+        }
+        char *end;
+        uint64_t id = strtoull(p, &end, 10);
+        double x = strtod(end, &p);
+        double y = strtod(p, &end);
+        vertex_t v;
+        if (end == p || !G->from_file_id(id, &v)) {
+            cerr << "Bad coordinate line: " << line;
+            fclose(f);
+            return false;
+        }
+        if (dimacs) {
+            x /= 1e6;
+            y /= 1e6;
+        }
+        this->px[v] = x;
+        this->py[v] = y;
+        if (!seen[v]) {
+            seen[v] = true;
+            count++;
+        }
+    }
+    fclose(f);
+    if (count != n) {
+        cerr << "Coordinates are missing for " << n - count << " vertices" << endl;
+        return false;
+    }
+
+    if (kind == HEURISTIC_HAVERSINE) {
+        // longitude / latitude in degrees -> point on the unit sphere, so the
+        // central angle follows from the chord (this is the haversine formula)
+        this->pz.resize(n);
+        for (vertex_t v = 0; v < n; v++) {
+            double lon = this->px[v] * M_PI / 180;
+            double lat = this->py[v] * M_PI / 180;
+            this->px[v] = cos(lat) * cos(lon);
+            this->py[v] = cos(lat) * sin(lon);
+            this->pz[v] = sin(lat);
+        }
+    }
+
+    // smallest weight per unit of distance, over every edge with distinct endpoints
+    vector<double> minimum(numOfThreads, HUGE_VAL);
+    vector<thread> workers;
+    for (int t = 0; t < numOfThreads; t++) {
+        vertex_t first = (vertex_t) ((uint64_t) n * t / numOfThreads);
+        vertex_t last = (vertex_t) ((uint64_t) n * (t + 1) / numOfThreads);
+        workers.push_back(thread([this, G, &minimum, t, first, last]() {
+            double m = HUGE_VAL;
+            for (vertex_t u = first; u < last; u++) {
+                for (edge_t e = G->offsets[u]; e < G->offsets[u + 1]; e++) {
+                    double d = this->distance(u, G->targets[e]);
+                    if (d > 0 && G->weights[e] < m * d) {
+                        m = G->weights[e] / d;
+                    }
+                }
+            }
+            minimum[t] = m;
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    this->scale = HUGE_VAL;
+    for (int t = 0; t < numOfThreads; t++) {
+        this->scale = min(this->scale, minimum[t]);
+    }
+    // no edge spans any distance: fall back to plain Dijkstra
+    if (this->scale == HUGE_VAL) {
+        this->scale = 0;
+    }
+    // keep floating point rounding from pushing an estimate past the true distance
+    this->scale *= 1 - 1e-7;
+
+    cout << "loaded " << n << " coordinates, heuristic scale " << this->scale << " per unit" << endl;
+    return true;
+}
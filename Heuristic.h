@@ -0,0 +1,69 @@
+#ifndef MULTIQUEUE_HEURISTIC_H
+#define MULTIQUEUE_HEURISTIC_H
+
+#include <string>
+#include <vector>
+#include <math.h>
+#include "Graph.h"
+#include "Landmarks.h"
+
+enum HeuristicKind {
+    HEURISTIC_NONE,
+    HEURISTIC_EUCLIDEAN,    // straight-line distance between planar coordinates
+    HEURISTIC_HAVERSINE,    // great-circle distance between longitude / latitude pairs
+    HEURISTIC_LANDMARKS     // ALT: triangle inequality bounds from a landmark table
+};
+
+// Parses "none", "euclidean" or "haversine". Returns false for anything else.
+bool parse_heuristic(const std::string &name, HeuristicKind *kind);
+
+// A* lower bounds from vertex coordinates or a landmark table. The coordinate
+// distance is turned into a weight by the smallest weight per unit of
+// distance over all edges, so estimate() never exceeds the true shortest path
+// length and satisfies h(u) <= w(u, v) + h(v) up to rounding. Landmark bounds
+// are exact integers and consistent.
+class Heuristic {
+    public:
+        Heuristic() : kind(HEURISTIC_NONE), scale(0), landmarks(NULL) {}
+        HeuristicKind kind;
+
+        // Reads one "v id x y" (DIMACS .co, x and y in millionths of a degree)
+        // or "id x y" line per vertex, ids in the file's numbering. Haversine
+        // takes x as the longitude and y as the latitude in degrees.
+        bool load(const std::string &path, const Graph *G, HeuristicKind kind, int numOfThreads);
+        // bounds from table, which must outlive the heuristic
+        void use_landmarks(const LandmarkTable *table) {
+            kind = HEURISTIC_LANDMARKS;
+            landmarks = table;
+        }
+
+        // lower bound on the length of a shortest v - t path
+        dist_t estimate(vertex_t v, vertex_t t) const {
+            if (kind == HEURISTIC_LANDMARKS) {
+                dist_t d = landmarks->bound(v, t);
+                return d < DIST_INF / 2 ? d : DIST_INF / 2;
+            }
+            double d = scale * distance(v, t);
+            // any smaller bound is still a lower bound; this one leaves room for additions
+            return d < DIST_INF / 2 ? (dist_t) d : DIST_INF / 2;
+        }
+
+    private:
+        std::vector<double> px, py, pz;     // by internal id; pz only for haversine
+        double scale;                       // weight per unit of coordinate distance
+        const LandmarkTable *landmarks;
+
+        double distance(vertex_t u, vertex_t v) const {
+            double dx = px[u] - px[v];
+            double dy = py[u] - py[v];
+            double dz = pz.empty() ? 0 : pz[u] - pz[v];
+            double d = sqrt(dx * dx + dy * dy + dz * dz);
+            if (kind == HEURISTIC_HAVERSINE) {
+                // points sit on the unit sphere: chord length -> central angle
+                d = 2 * asin(d < 2 ? d / 2 : 1);
+            }
+            return d;
+        }
+};
+
+#endif //MULTIQUEUE_HEURISTIC_H
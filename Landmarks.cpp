@@ -0,0 +1,184 @@
+#include "Landmarks.h"
+#include "ParallelDijkstra.h"
+#include "Parallel.h"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+
+// The reachable vertex with the largest score (vertices scored DIST_INF were
+// not reached and are skipped).
+static vertex_t farthest(const vector<dist_t> &score) {
+    vertex_t best = 0;
+    for (vertex_t v = 1; v < score.size(); v++) {
+        if (score[v] != DIST_INF && (score[best] == DIST_INF || score[v] > score[best])) {
+            best = v;
+        }
+    }
+    return best;
+}
+
+
+void LandmarkTable::select(Graph *G, int count, int c, int p, int concurrent, bool huge_pages,
+                           const ThreadPlacement *placement) {
+
+    vertex_t n = G->num_vertices;
+    concurrent = max(1, min(concurrent, min(p, count)));
+    this->k = count;
+    this->directed = G->directed;
+    this->landmarks.clear();
+    this->rows.resize((size_t) n * count);
+
+    Allocator::init_allocator(p);
+    vector<DijkstraSolver*> solvers;
+    for (int s = 0; s < concurrent; s++) {
+        int first = p * s / concurrent;
+        int size = p * (s + 1) / concurrent - first;
+        solvers.push_back(new DijkstraSolver(G, c, size, first, huge_pages, placement));
+    }
+
+    // distance from each vertex to its nearest landmark
+    vector<dist_t> nearest(n, DIST_INF);
+    vector<dist_t> score(n);
+
+    solvers[0]->solve(G->source);
+    for (vertex_t v = 0; v < n; v++) {
+        score[v] = solvers[0]->distances[v].load(std::memory_order_relaxed);
+    }
+    vector<vertex_t> round(1, farthest(score));
+
+    while (true) {
+        // one search per landmark of the round, each copied into its column
+        size_t column = this->landmarks.size();
+        vector<thread> controllers;
+        for (size_t r = 0; r < round.size(); r++) {
+            DijkstraSolver *solver = solvers[r];
+            vertex_t landmark = round[r];
+            dist_t *table = this->rows.data();
+            int k = this->k;
+            controllers.push_back(thread([solver, landmark, table, k, n, column, r]() {
+                solver->solve(landmark);
+                for (vertex_t v = 0; v < n; v++) {
+                    table[(size_t) v * k + column + r] = solver->distances[v].load(std::memory_order_relaxed);
+                }
+            }));
+        }
+        for (size_t r = 0; r < controllers.size(); r++) {
+            controllers[r].join();
+        }
+        this->landmarks.insert(this->landmarks.end(), round.begin(), round.end());
+        int columns = (int) this->landmarks.size();
+
+        for_each_slice(n, p, [this, &nearest, column, columns](int, size_t first, size_t last) {
+            for (vertex_t v = first; v < last; v++) {
+                for (int i = (int) column; i < columns; i++) {
+                    nearest[v] = min(nearest[v], this->rows[(size_t) v * this->k + i]);
+                }
+            }
+        });
+        if (columns == count) {
+            break;
+        }
+
+        // the next round, farthest first; a vertex close to an earlier pick of
+        // the same round is a poor landmark, so its score drops to the bound
+        round.clear();
+        score = nearest;
+        int picks = min(concurrent, count - columns);
+        for (int r = 0; r < picks; r++) {
+            vertex_t u = farthest(score);
+            round.push_back(u);
+            if (r + 1 < picks) {
+                for_each_slice(n, p, [this, &score, u, columns](int, size_t first, size_t last) {
+                    for (vertex_t v = first; v < last; v++) {
+                        score[v] = min(score[v], this->bound(v, u, columns));
+                    }
+                });
+            }
+        }
+    }
+
+    for (size_t s = 0; s < solvers.size(); s++) {
+        delete solvers[s];
+    }
+    Allocator::destroy_allocator();
+}
+
+
+bool LandmarkTable::save(const std::string &path, const Graph *G) const {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    LandmarkFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LANDMARK_FILE_MAGIC, sizeof(LANDMARK_FILE_MAGIC));
+    header.version = LANDMARK_FILE_VERSION;
+    header.dist_bytes = sizeof(dist_t);
+    header.num_vertices = G->num_vertices;
+    header.num_landmarks = this->k;
+
+    vector<uint64_t> ids(G->num_vertices);
+    for (vertex_t i = 0; i < G->num_vertices; i++) {
+        ids[G->internal_id(i)] = i;
+    }
+    vector<uint64_t> landmark_ids(this->k);
+    for (int i = 0; i < this->k; i++) {
+        landmark_ids[i] = ids[this->landmarks[i]] + G->id_base;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(landmark_ids.data(), sizeof(uint64_t), this->k, f) == (size_t) this->k;
+    // rows in file order
+    if (ok && G->relabel.empty()) {
+        size_t size = (size_t) G->num_vertices * this->k;
+        ok = fwrite(this->rows.data(), sizeof(dist_t), size, f) == size;
+        return fclose(f) == 0 && ok;
+    }
+    for (vertex_t i = 0; ok && i < G->num_vertices; i++) {
+        ok = fwrite(this->rows.data() + (size_t) G->internal_id(i) * this->k, sizeof(dist_t), this->k, f) ==
+             (size_t) this->k;
+    }
+    return fclose(f) == 0 && ok;
+}
+
+
+bool LandmarkTable::load(const std::string &path, const Graph *G) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    LandmarkFileHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, LANDMARK_FILE_MAGIC, sizeof(LANDMARK_FILE_MAGIC)) != 0 ||
+        header.version != LANDMARK_FILE_VERSION || header.dist_bytes != sizeof(dist_t) ||
+        header.num_vertices != G->num_vertices || header.num_landmarks == 0) {
+        cerr << "Landmark file " << path << " does not match this graph and build" << endl;
+        fclose(f);
+        return false;
+    }
+
+    this->k = header.num_landmarks;
+    this->directed = G->directed;
+    vector<uint64_t> landmark_ids(this->k);
+    this->landmarks.resize(this->k);
+    bool ok = fread(landmark_ids.data(), sizeof(uint64_t), this->k, f) == (size_t) this->k;
+    for (int i = 0; ok && i < this->k; i++) {
+        ok = G->from_file_id(landmark_ids[i], &this->landmarks[i]);
+    }
+    this->rows.resize((size_t) G->num_vertices * this->k);
+    if (ok && G->relabel.empty()) {
+        size_t size = (size_t) G->num_vertices * this->k;
+        ok = fread(this->rows.data(), sizeof(dist_t), size, f) == size;
+        fclose(f);
+        return ok;
+    }
+    for (vertex_t i = 0; ok && i < G->num_vertices; i++) {
+        ok = fread(this->rows.data() + (size_t) G->internal_id(i) * this->k, sizeof(dist_t), this->k, f) ==
+             (size_t) this->k;
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,77 @@
+#ifndef MULTIQUEUE_LANDMARKS_H
+#define MULTIQUEUE_LANDMARKS_H
+
+#include <string>
+#include <vector>
+#include "Graph.h"
+#include "Affinity.h"
+
+#define LANDMARK_FILE_MAGIC "MQLANDM"
+#define LANDMARK_FILE_VERSION 1
+
+// On-disk layout of a landmark table: this header, num_landmarks landmark ids
+// (uint64_t, in the graph file's numbering), then one row of num_landmarks
+// distances per vertex, in the graph file's vertex order. Distances use the
+// recorded width and DIST_INF for unreachable vertices.
+struct LandmarkFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dist_bytes;        // sizeof(dist_t)
+    uint64_t num_vertices;
+    uint32_t num_landmarks;
+    uint32_t reserved;
+};
+
+// Exact distances from a few landmark vertices, for ALT lower bounds: by the
+// triangle inequality, d(L, t) - d(L, v) <= d(v, t) for every landmark L, and
+// in an undirected graph also d(L, v) - d(L, t) <= d(t, v) = d(v, t).
+class LandmarkTable {
+    public:
+        LandmarkTable() : k(0), directed(false) {}
+        std::vector<vertex_t> landmarks;    // ids of G
+        int k;
+        bool directed;                      // only the one-sided bound holds
+
+        // Picks count landmarks by farthest-point selection and fills in their
+        // distances with the MultiQueues engine. The first landmark is the
+        // vertex farthest from G->source; after that each round picks up to
+        // `concurrent` landmarks, each the vertex farthest from every landmark
+        // so far, where the distance to landmarks of the current round (whose
+        // searches have not run yet) is estimated by the bounds of the table.
+        // The round's searches then run side by side on p / concurrent threads.
+        void select(Graph *G, int count, int c, int p, int concurrent, bool huge_pages,
+                    const ThreadPlacement *placement);
+
+        // Both return false on I/O failure or, when loading, a table made for
+        // a different graph or distance width.
+        bool load(const std::string &path, const Graph *G);
+        bool save(const std::string &path, const Graph *G) const;
+
+        // lower bound on d(v, t) from the first `columns` landmarks
+        dist_t bound(vertex_t v, vertex_t t, int columns) const {
+            const dist_t *rv = rows.data() + (size_t) v * k;
+            const dist_t *rt = rows.data() + (size_t) t * k;
+            dist_t best = 0;
+            for (int i = 0; i < columns; i++) {
+                if (rv[i] == DIST_INF || rt[i] == DIST_INF) {
+                    // one is reachable from the landmark, the other is not; in a
+                    // directed graph only an unreachable t rules out a v - t path
+                    if (rv[i] != rt[i] && (!directed || rt[i] == DIST_INF)) {
+                        return DIST_INF;
+                    }
+                    continue;
+                }
+                dist_t d = rv[i] > rt[i] ? (directed ? 0 : rv[i] - rt[i]) : rt[i] - rv[i];
+                if (d > best) {
+                    best = d;
+                }
+            }
+            return best;
+        }
+        dist_t bound(vertex_t v, vertex_t t) const { return bound(v, t, k); }
+
+    private:
+        GraphArray<dist_t> rows;            // rows[v * k + i] = d(landmarks[i], v)
+};
+
+#endif //MULTIQUEUE_LANDMARKS_H
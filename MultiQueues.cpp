@@ -4,10 +4,14 @@
 
 #include "MultiQueues.h"
 
-MultiQueues::MultiQueues(int c, int p) {
+// capacityHint is the expected number of offers held by the whole structure at
+// once; it is spread evenly over the c*p queues.
+MultiQueues::MultiQueues(int c, int p, size_t capacityHint, bool hugePages) {
     this->c = c;
     this->p = p;
     this->numOfQueues = c*p;
+    this->capacityHint = (int) min(capacityHint / this->numOfQueues, (size_t) INT_MAX / 2);
+    this->hugePages = hugePages;
     this->queues = new dAryMinHeap*[numOfQueues];
     this->locks = new std::mutex*[numOfQueues];
     this->init();
@@ -19,7 +23,7 @@ MultiQueues::MultiQueues(int c, int p) {
 
 void MultiQueues:: init() {
     for(int i=0 ; i < this->numOfQueues; i++) {
-        this->queues[i] = new dAryMinHeap(QUEUE_CAPACITY);
+        this->queues[i] = new dAryMinHeap(this->capacityHint, this->hugePages);
         this->locks[i] = new std::mutex();
     }
 
@@ -31,7 +35,41 @@ bool MultiQueues::is_empty(){
     return false;
 }
 
-Offer* MultiQueues::insert(Vertex* vertex, int dist, int tid) {
+// True if some queued offer may have a key below bound. Reads the cached
+// queue tops without locking, so an offer that is being inserted concurrently
+// can be missed; only its inserter is sure to see it.
+bool MultiQueues::has_below(dist_t bound){
+    if (this->numOffers == 0){
+        return false;
+    }
+    if (bound == DIST_INF){
+        return true;
+    }
+    for (int i = 0; i < this->numOfQueues; i++){
+        if (this->queues[i]->minKey() < bound){
+            return true;
+        }
+    }
+    return false;
+}
+
+// Drops the offers left in queues part, part + parts, ...; the callers split
+// the queues among themselves so that together they empty the structure.
+void MultiQueues::clear(int part, int parts, int tid){
+
+    Allocator::enterQuiescentState(tid);
+    for (int i = part; i < this->numOfQueues; i += parts){
+        locks[i]->lock();
+        while (!this->queues[i]->isEmpty()){
+            Allocator::free(this->queues[i]->extractMin(), tid);
+            this->numOffers--;
+        }
+        locks[i]->unlock();
+    }
+    Allocator::leaveQuiescentState(tid);
+}
+
+void MultiQueues::insert(vertex_t vertex, dist_t dist, int tid) {
 
     Allocator::enterQuiescentState(tid);
 
@@ -50,7 +88,6 @@ Offer* MultiQueues::insert(Vertex* vertex, int dist, int tid) {
     locks[queueIndex]->unlock();
 
     Allocator::leaveQuiescentState(tid);
-    return offer;
 }
 
 bool MultiQueues::deleteMin(Offer *out, int tid) {
@@ -80,7 +117,7 @@ minLoop:
         else if(this->queues[i]->isEmpty() && !this->queues[j]->isEmpty())
             minIndex = j;
         else {
-            if (this->queues[i]->findMin() < this->queues[j]->findMin())
+            if (this->queues[i]->minKey() < this->queues[j]->minKey())
                 minIndex = i;
             else
                 minIndex = j;
@@ -15,7 +15,6 @@
 #include <thread>
 
 
-#define QUEUE_CAPACITY 2048
 using namespace std;
 
 
@@ -25,17 +24,21 @@ class MultiQueues {
     int p;
     unsigned int *seed = new unsigned int[1];
     int numOfQueues;
-    atomic<int> numOffers;
+    atomic<long> numOffers;
+    int capacityHint;
+    bool hugePages;
     dAryMinHeap** queues;
     std::mutex** locks;
 
     public:
-        MultiQueues(int c, int p);
-        Offer* insert(Vertex* vertex, int dist, int tid);
+        MultiQueues(int c, int p, size_t capacityHint = HEAP_MIN_CAPACITY, bool hugePages = false);
+        void insert(vertex_t vertex, dist_t dist, int tid);
         bool deleteMin(Offer *out, int tid);
         void init();
         int getRandomQueueIndex();
         bool is_empty();
+        bool has_below(dist_t bound);
+        void clear(int part, int parts, int tid);
         ~MultiQueues();
 
 };
@@ -0,0 +1,41 @@
+#ifndef MULTIQUEUE_PARALLEL_H
+#define MULTIQUEUE_PARALLEL_H
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// Runs body(t, first, last) on numOfThreads threads, thread t taking the t-th
+// of numOfThreads equal slices of [0, n).
+static inline void for_each_slice(size_t n, int numOfThreads,
+                                  const std::function<void(int, size_t, size_t)> &body) {
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numOfThreads; t++) {
+        size_t first = (size_t) ((uint64_t) n * t / numOfThreads);
+        size_t last = (size_t) ((uint64_t) n * (t + 1) / numOfThreads);
+        workers.push_back(std::thread(body, t, first, last));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+// Runs body(t, i) for every i in [0, n) on numOfThreads threads that take
+// blocks of indices from a shared counter, for work of uneven cost.
+static inline void for_each_index(size_t n, int numOfThreads, const std::function<void(int, size_t)> &body,
+                                  size_t block = 64) {
+    std::atomic<size_t> next(0);
+    for_each_slice(numOfThreads, numOfThreads, [&](int t, size_t, size_t) {
+        for (size_t first = next.fetch_add(block); first < n; first = next.fetch_add(block)) {
+            size_t last = first + block < n ? first + block : n;
+            for (size_t i = first; i < last; i++) {
+                body(t, i);
+            }
+        }
+    });
+}
+
+#endif //MULTIQUEUE_PARALLEL_H
@@ -10,16 +10,23 @@
 #include "ParallelDijkstra.h"
 #include "MultiQueues.h"
 #include "Allocator.h"
+#include "Distances.h"
+#include "SequentialDijkstra.h"
 #include <unistd.h>
 #include <array>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 using namespace std;
 
-pthread_mutex_t done_work_lock;
-pthread_cond_t done_work_cond;
 
+int DijkstraSolver::prefetchDistance = PREFETCH_DISTANCE;
+RelaxKernel DijkstraSolver::relaxKernel = RELAX_AUTO;
 
-bool finished_work(bool done[], int numOfThreads){
+
+bool finished_work(std::atomic<bool> done[], int numOfThreads){
     for (int i = 0; i < numOfThreads; i++){
         if(!done[i]){
             return false;
@@ -28,234 +35,886 @@ bool finished_work(bool done[], int numOfThreads){
     return true;
 }
 
-void relax(MultiQueues* queue, int* distances, std::mutex **distancesLocks, std::mutex **offersLocks, Offer **offers, Vertex* vertex, int alt, int tid) {
-    Offer* curr_offer;
-
-    offersLocks[vertex->index]->lock();
-
-    distancesLocks[vertex->index]->lock();
-    int curr_dist = distances[vertex->index];
-    distancesLocks[vertex->index]->unlock();
-
-    if (alt < curr_dist) {
-
-        curr_offer = offers[vertex->index];
-        if (curr_offer == NULL || alt < curr_offer->dist ){
+// Lowers the key offered for vertex to alt, and queues the offer if alt is
+// below bound. Returns true when this call lowered the key. With labels, the
+// offer is also recorded there as coming from `from`.
+bool relax(MultiQueues* queue, std::atomic<dist_t>* distances, std::atomic<dist_t> *offerKeys,
+           std::atomic<label_t> *labels, vertex_t from, vertex_t vertex, dist_t alt, dist_t bound, int tid) {
 
-            Offer* new_offer = queue->insert(vertex, alt, tid);
-            new_offer->vertex = vertex;
-            new_offer->dist = alt;
-
-            Allocator::enterQuiescentState(tid);
-            Offer* offer = Allocator::allocate(tid);
-            offer->vertex = vertex;
-            offer->dist = alt;
-            Allocator::leaveQuiescentState(tid);
-
-
-            if (offers[vertex->index]) {
-                Allocator::enterQuiescentState(tid);
-                Allocator::free(offers[vertex->index], tid);
-                Allocator::leaveQuiescentState(tid);
+    if (alt >= distances[vertex].load(std::memory_order_relaxed)) {
+        return false;
+    }
+    // offerKeys holds the smallest key offered for the vertex so far; only the
+    // thread that lowers it queues the candidate
+    if (!atomic_min(offerKeys[vertex], alt)) {
+        return false;
+    }
+    // another thread may lower the key again before this label lands; the
+    // label's own atomic_min still ends on the smallest key
+    if (labels) {
+        atomic_min(labels[vertex], make_label(alt, from));
+    }
+    if (alt < bound) {
+        queue->insert(vertex, alt, tid);
+    }
+    return true;
+}
 
-            }
-            offers[vertex->index] = offer;
 
+// Records a path through vertex once both searches have reached it. Each side
+// lowers its own key before reading the other's (both sequentially
+// consistent), so for every vertex at least one of the two sides sees both
+// final keys.
+static void meet(DijkstraSolver *solver, std::atomic<dist_t> *otherKeys, vertex_t vertex, dist_t key) {
+    dist_t other = otherKeys[vertex].load();
+    if (other != DIST_INF) {
+        dist_t length = other > DIST_INF - key ? DIST_INF : key + other;
+        atomic_min(solver->best, length);
+        if (solver->labels) {
+            atomic_min(solver->meeting, make_label(length, vertex));
         }
     }
-    offersLocks[vertex->index]->unlock();
+}
+
 
+// distances[vertex] is read by relax, offerKeys[vertex] read and maybe CASed
+static inline void prefetch_state(const std::atomic<dist_t> *distances, const std::atomic<dist_t> *offerKeys,
+                                  vertex_t vertex) {
+    __builtin_prefetch(&distances[vertex], 0);
+    __builtin_prefetch(&offerKeys[vertex], 1);
 }
 
 
 class ThreadInput {
 public:
-    bool *done;
-    MultiQueues* queue;
-    int p;
-    Graph *G;
-    std::mutex **offersLocks;
-    std::mutex **distancesLocks;
-    int tid;
-    int * distances;
-    Offer ** offers;
-
-    ThreadInput(bool *done, MultiQueues *queue, int p, Graph *G, int * distances, std::mutex **offersLocks,
-                std::mutex **distancesLocks, Offer ** offers, int tid) {
-        this->done = done;
-        this->queue = queue;
-        this->p = p;
-        this->G = G;
-        this->distances = distances;
-        this->offersLocks = offersLocks;
-        this->distancesLocks = distancesLocks;
-        this->offers = offers;
-        this->tid = tid;
+    DijkstraSolver *solver;
+    int tid;            // record manager tid
+    int index;          // position among the solver's workers
+
+    ThreadInput(DijkstraSolver *solver, int index) {
+        this->solver = solver;
+        this->index = index;
+        this->tid = solver->firstTid + index;
     }
 };
 
 
+// Offers at or above the bound are dropped. Without a target it is DIST_INF.
+// A one-sided search is bounded by the best key offered to the target so far.
+// In a bidirectional search each side drops keys k with 2k >= best: if a path
+// shorter than best existed, it would have an edge (u, w) with u closer than
+// best / 2 to the source and w closer than best / 2 to the target, both
+// explored with exact keys, so their meeting at w would have lowered best.
+dist_t DijkstraSolver::bound() const {
+    if (!this->hasTarget) {
+        return DIST_INF;
+    }
+    if (!this->bidirectional) {
+        return this->offerKeys[this->target].load();
+    }
+    dist_t mu = this->best.load();
+    return mu - mu / 2;
+}
+
+
+// One query's search loop, run by every worker of the solver.
 void *parallel_Dijkstra(void *void_input) {
 
     ThreadInput * input = (ThreadInput *) void_input;
-    bool * done = input->done;
-    MultiQueues *queue = input->queue;
-    Graph *G = input->G;
-    Offer **offers = input->offers;
+    DijkstraSolver *solver = input->solver;
+    std::atomic<bool> * done = solver->done;
     int tid = input->tid;
+    int index = input->index;
 
-    Vertex *curr_v;
-    Vertex *neighbor;
+    vertex_t curr_v;
     bool explore = true;
-    int curr_dist = -1;
-    int alt;
-    int weight;
-
-    int* distances = input->distances;
-    std::mutex ** offersLocks = input->offersLocks;
-    std::mutex **distancesLocks = input->distancesLocks;
-    int p =input->p;
+    dist_t curr_dist = -1;
+
+    // direction 0 searches forward from the source over G, direction 1
+    // backward from the target over R
+    int directions = solver->bidirectional ? 2 : 1;
+    MultiQueues *queues[2] = {solver->queue, solver->backQueue};
+    std::atomic<dist_t> *distances[2] = {solver->distances, solver->backDistances};
+    std::atomic<dist_t> *offerKeys[2] = {solver->offerKeys, solver->backOfferKeys};
+    std::atomic<label_t> *labels[2] = {solver->labels, solver->backLabels};
+    Graph *graphs[2] = {solver->G, solver->R};
+    const Heuristic *heuristic = solver->hasTarget && !solver->bidirectional ? solver->heuristic : NULL;
+    vertex_t target = solver->target;
+    int p = solver->p;
+    edge_t ahead = DijkstraSolver::prefetchDistance;
+    ImprovingArcs improving = heuristic ? NULL : solver->improving;
+    edge_t width = solver->relaxWidth;
 
     Offer min_offer = {};
     bool got_min;
 
+    // workers start on alternating sides; scan[d] is set once direction d may
+    // have run out of offers below its bound and must be checked again
+    int dir = index % directions;
+    bool scan[2] = {true, true};
+
+    // kept in locals and added to the thread's slot once the query is over
+    WorkCounts counts;
+    uint64_t *count = counts.count;
 
     while (true) {
-        if (queue->is_empty()== true){
-            done[tid] = true;
+        // a thread stays in the search while it sees pending offers below the
+        // bound of either side; it only leaves once every worker has seen none
+        if (scan[dir] && !queues[dir]->has_below(solver->bound())) {
+            int other = directions - 1 - dir;
+            if (other != dir && (!scan[other] || queues[other]->has_below(solver->bound()))) {
+                dir = other;
+            } else {
+                done[index] = true;
+                if (finished_work(done, p)) {
+                    solver->counters->slot(index).add(counts);
+                    return NULL;
+                }
+                else
+                    continue;
+            }
         }
 
-        if (!done[tid]){
-            got_min = queue->deleteMin(&min_offer, tid);
-        }
-        else{
-            if (finished_work(done, p))
-                return NULL;
-            else
-                continue;
-        }
+        done[index] = false;
+        got_min = queues[dir]->deleteMin(&min_offer, tid);
         if (!got_min) {
-            done[tid] = true;
-            if (finished_work(done, p))
-                return NULL;
-            else
-                continue;
+            scan[dir] = true;
+            continue;
         }
 
-        done[tid] = false;
-
         curr_v = min_offer.vertex;
         curr_dist = min_offer.dist;
+        count[COUNT_POPS]++;
 
-        distancesLocks[curr_v->index]->lock();
-        if (curr_dist < distances[curr_v->index]) {
-            distances[curr_v->index] = curr_dist;
-            explore = true;
-        } else {
-            explore = false;
+        dist_t bound = solver->bound();
+        if (curr_dist >= bound) {
+            scan[dir] = true;
+            continue;
+        }
+        scan[dir] = false;
+
+        // a stale offer (the vertex was already settled at least as cheaply) is dropped
+        dist_t settled = distances[dir][curr_v].load(std::memory_order_relaxed);
+        explore = atomic_min(distances[dir][curr_v], curr_dist);
+        if (!explore) {
+            count[COUNT_STALE_POPS]++;
+        } else if (settled != DIST_INF) {
+            count[COUNT_REEXPLORATIONS]++;
         }
-        distancesLocks[curr_v->index]->unlock();
 
         if (explore) {
-            for (int i = 0; i < (curr_v->neighbors.size()); i++) {
-                neighbor = curr_v->neighbors[i].first;
-                weight = curr_v->neighbors[i].second;
-                alt = curr_dist + weight;
-                relax(queue,distances, distancesLocks,offersLocks,offers,neighbor,alt, tid);
+            const edge_t *offsets = graphs[dir]->offsets.data();
+            const vertex_t *targets = graphs[dir]->targets.data();
+            const int *weights = graphs[dir]->weights.data();
+            // A* keys: g(v) + h(v) = (curr_dist - h(curr_v)) + w + h(v)
+            dist_t g = heuristic ? curr_dist - heuristic->estimate(curr_v, target) : curr_dist;
+            auto relax_arc = [&](vertex_t v, dist_t alt) {
+                bool lowered = relax(queues[dir], distances[dir], offerKeys[dir], labels[dir], curr_v, v, alt, bound,
+                                     tid);
+                count[lowered ? COUNT_RELAXATIONS : COUNT_FAILED_RELAXATIONS]++;
+                count[COUNT_INSERTS] += lowered && alt < bound;
+                if (lowered && directions == 2) {
+                    meet(solver, offerKeys[1 - dir], v, alt);
+                }
+            };
+            edge_t e = offsets[curr_v];
+            edge_t last = offsets[curr_v + 1];
+            // whole blocks of arcs are screened at once, and only the arcs
+            // whose key would drop go on to relax; the gather already has
+            // all of a block's loads in flight
+            if (improving) {
+                dist_t alts[MAX_RELAX_WIDTH];
+                for (; e + width <= last; e += width) {
+                    uint32_t lanes = improving(g, targets + e, weights + e, offerKeys[dir], alts);
+                    count[COUNT_FAILED_RELAXATIONS] += width - __builtin_popcount(lanes);
+                    for (; lanes; lanes &= lanes - 1) {
+                        int i = __builtin_ctz(lanes);
+                        relax_arc(targets[e + i], alts[i]);
+                    }
+                }
+            }
+            // the targets' state sits at random addresses: requests for the
+            // next `ahead` arcs are kept in flight while this one is relaxed
+            for (edge_t a = e; a < e + ahead && a < last; a++) {
+                prefetch_state(distances[dir], offerKeys[dir], targets[a]);
+            }
+            for (; e < last; e++) {
+                if (e + ahead < last) {
+                    prefetch_state(distances[dir], offerKeys[dir], targets[e + ahead]);
+                }
+                dist_t alt = add_dist(g, weights[e]);
+                if (heuristic) {
+                    dist_t h = heuristic->estimate(targets[e], target);
+                    alt = alt > DIST_INF - h ? DIST_INF : alt + h;
+                }
+                relax_arc(targets[e], alt);
             }
         }
 
+        dir = (dir + 1) % directions;
     }
 }
 
 
+void *dijkstra_worker(void *void_input) {
 
+    ThreadInput * input = (ThreadInput *) void_input;
+    DijkstraSolver *solver = input->solver;
+    vertex_t n = solver->G->num_vertices;
+    int index = input->index;
 
-void dijkstra_shortest_path(Graph *G, int c, int p) {
+    // pin before touching any per-thread state so it is allocated near the core
+    if (solver->placement) {
+        solver->placement->pin_current(input->tid);
+    }
 
-    Allocator a = Allocator();
-    Allocator::init_allocator(p);
+    while (true) {
+        pthread_barrier_wait(&solver->start);
+        if (solver->shutdown) {
+            return NULL;
+        }
 
-    pthread_mutex_init(&done_work_lock, NULL);
-    pthread_cond_init(&done_work_cond, NULL);
+        // each worker resets its slice of the per-vertex state; a repair keeps
+        // it, update() has already reset what it invalidated
+        vertex_t first = (vertex_t) ((uint64_t) n * index / solver->p);
+        vertex_t last = (vertex_t) ((uint64_t) n * (index + 1) / solver->p);
+        if (solver->repairing) {
+            last = first;
+        }
+        for (vertex_t i = first; i < last; i++) {
+            solver->distances[i].store(DIST_INF, std::memory_order_relaxed);
+            solver->offerKeys[i].store(DIST_INF, std::memory_order_relaxed);
+        }
+        if (solver->bidirectional) {
+            for (vertex_t i = first; i < last; i++) {
+                solver->backDistances[i].store(DIST_INF, std::memory_order_relaxed);
+                solver->backOfferKeys[i].store(DIST_INF, std::memory_order_relaxed);
+            }
+        }
+        if (solver->labels) {
+            for (vertex_t i = first; i < last; i++) {
+                solver->labels[i].store(make_label(DIST_INF, NO_VERTEX), std::memory_order_relaxed);
+            }
+        }
+        if (solver->backLabels) {
+            for (vertex_t i = first; i < last; i++) {
+                solver->backLabels[i].store(make_label(DIST_INF, NO_VERTEX), std::memory_order_relaxed);
+            }
+        }
+        solver->done[index] = false;
+        pthread_barrier_wait(&solver->workers);
 
-    // create priority queue
-    MultiQueues *queue = new MultiQueues(c,p);
-    Offer min_offer = {};
+        if (index == 0 && solver->repairing) {
+            for (size_t i = 0; i < solver->seeds.size(); i++) {
+                solver->queue->insert(solver->seeds[i].vertex, solver->seeds[i].dist, input->tid);
+            }
+            solver->counters->slot(index).count[COUNT_INSERTS] += solver->seeds.size();
+        } else if (index == 0) {
+            dist_t key = 0;
+            if (solver->heuristic && solver->hasTarget && !solver->bidirectional) {
+                key = solver->heuristic->estimate(solver->source, solver->target);
+            }
+            solver->offerKeys[solver->source].store(key);
+            if (solver->labels) {
+                solver->labels[solver->source].store(make_label(key, NO_VERTEX));
+            }
+            solver->queue->insert(solver->source, key, input->tid);
+            if (solver->bidirectional) {
+                solver->best.store(solver->source == solver->target ? 0 : DIST_INF);
+                solver->meeting.store(make_label(solver->best.load(), solver->source));
+                solver->backOfferKeys[solver->target].store(0);
+                if (solver->backLabels) {
+                    solver->backLabels[solver->target].store(make_label(0, NO_VERTEX));
+                }
+                solver->backQueue->insert(solver->target, 0, input->tid);
+            }
+            WorkCounts &counts = solver->counters->slot(index);
+            counts.count[COUNT_INSERTS] += solver->bidirectional ? 2 : 1;
+            counts.queries++;
+        }
+        pthread_barrier_wait(&solver->workers);
 
+        parallel_Dijkstra(void_input);
 
-    int distances[G->vertices.size()];
-    Offer *offers[G->vertices.size()];
+        // a bounded search leaves the offers it pruned behind
+        if (solver->hasTarget) {
+            pthread_barrier_wait(&solver->workers);
+            solver->queue->clear(index, solver->p, input->tid);
+            if (solver->bidirectional) {
+                solver->backQueue->clear(index, solver->p, input->tid);
+            }
+        }
+        pthread_barrier_wait(&solver->finish);
+    }
+}
 
-    std::mutex **offersLocks = new std::mutex *[G->vertices.size()];
-    std::mutex **distancesLocks = new std::mutex *[G->vertices.size()];
 
-    //init
-    for (int i = 0; i < G->vertices.size(); i++) {
-        distances[i] = INT_MAX;
-        offers[i] =NULL;
+DijkstraSolver::DijkstraSolver(Graph *G, int c, int p, int firstTid, bool huge_pages, const ThreadPlacement *placement,
+                               bool bidirectional, bool predecessors) {
+    this->G = G;
+    this->R = G->backward();
+    if (bidirectional && this->R == NULL) {
+        cerr << "A bidirectional search of a directed graph needs its reverse graph" << endl;
+        exit(1);
     }
+    this->p = p;
+    this->firstTid = firstTid;
+    this->placement = placement;
+    this->bidirectional = bidirectional;
+    this->source = G->source;
+    this->target = G->source;
+    this->hasTarget = false;
+    this->shutdown = false;
+    this->repairing = false;
+    this->solved = false;
+
+    Allocator::init_allocator(firstTid + p);
+
+    // create priority queue, sized for roughly one pending offer per vertex
+    this->queue = new MultiQueues(c, p, G->num_vertices, huge_pages);
+
+    // per-vertex state lives on the heap; as stack arrays it overflowed past a few million vertices
+    this->distances = new std::atomic<dist_t>[G->num_vertices];
+    this->offerKeys = new std::atomic<dist_t>[G->num_vertices];
+    this->done = new std::atomic<bool>[p];
+    this->counters = new WorkCounters(p);
+
+    // the gathers take signed 32-bit indices
+    this->kernel = relaxKernel == RELAX_AUTO ? best_relax_kernel() : relaxKernel;
+    if (!relax_kernel_supported(this->kernel) || G->num_vertices > (vertex_t) numeric_limits<int>::max()) {
+        this->kernel = RELAX_SCALAR;
+    }
+    this->improving = relax_kernel_function(this->kernel);
+    this->relaxWidth = relax_kernel_width(this->kernel);
+
+    this->backQueue = NULL;
+    this->backDistances = NULL;
+    this->backOfferKeys = NULL;
+    this->best = DIST_INF;
+    this->heuristic = NULL;
+    if (bidirectional) {
+        this->backQueue = new MultiQueues(c, p, G->num_vertices, huge_pages);
+        this->backDistances = new std::atomic<dist_t>[G->num_vertices];
+        this->backOfferKeys = new std::atomic<dist_t>[G->num_vertices];
+    }
+    this->labels = NULL;
+    this->backLabels = NULL;
+    this->meeting = make_label(DIST_INF, NO_VERTEX);
+    if (predecessors) {
+        this->labels = new std::atomic<label_t>[G->num_vertices];
+        if (bidirectional) {
+            this->backLabels = new std::atomic<label_t>[G->num_vertices];
+        }
+    }
+
+    pthread_barrier_init(&this->start, NULL, p + 1);
+    pthread_barrier_init(&this->finish, NULL, p + 1);
+    pthread_barrier_init(&this->workers, NULL, p);
 
-    //init locks
-    for (int i = 0; i < G->vertices.size(); i++) {
-        offersLocks[i] = new std::mutex();
-        distancesLocks[i] = new std::mutex();
+    this->threads.resize(p);
+    for (int i = 0; i < p; i++) {
+        this->inputs.push_back(new ThreadInput(this, i));
+        pthread_create(&this->threads[i], NULL, &dijkstra_worker, this->inputs[i]);
     }
+}
 
-    // initialization
-    distances[G->source] = INT_MAX;
 
-    //don't need to use Debra by Or
-    min_offer.vertex = G->vertices[G->source];
-    min_offer.dist = 0;
+void DijkstraSolver::run() {
+    pthread_barrier_wait(&this->start);
+    pthread_barrier_wait(&this->finish);
+}
 
-    queue->insert(min_offer.vertex, min_offer.dist, 0);
 
-    int num_of_threads = p;
-    pthread_t threads[num_of_threads];
-    bool done[p];
+void DijkstraSolver::solve(vertex_t source) {
+    if (this->bidirectional) {
+        cerr << "A bidirectional solver only answers point-to-point queries" << endl;
+        exit(1);
+    }
+    this->source = source;
+    this->hasTarget = false;
+    this->run();
+    this->solved = true;
+}
 
-    std::vector<ThreadInput*>to_delete;
-    for (int i = 0; i < num_of_threads; i++) {
-        done[i] = false;
-        to_delete.push_back(new ThreadInput(done, queue, p, G, distances, offersLocks, distancesLocks, offers, i));
 
-        pthread_create(&threads[i], NULL, &parallel_Dijkstra, (void *) to_delete[i]);
+vertex_t DijkstraSolver::update(const std::vector<Edge> &updates) {
+    if (!this->solved || !this->labels || this->R == NULL) {
+        cerr << "Updates need a solve() with predecessors and the reverse graph" << endl;
+        exit(1);
+    }
+    vector<int> previous;
+    this->G->update_arcs(updates, &previous);
+
+    // every arc that changed, with its weight before the batch and its final
+    // weight: a batch may set an arc more than once, and an undirected edge
+    // from either end, so the updates are grouped by edge, in batch order
+    bool undirected = !this->G->directed;
+    auto edge_key = [&updates, undirected](size_t i) {
+        vertex_t u = updates[i].u;
+        vertex_t v = updates[i].v;
+        return undirected && v < u ? make_pair(v, u) : make_pair(u, v);
+    };
+    vector<size_t> order(updates.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&edge_key](size_t a, size_t b) {
+        return edge_key(a) < edge_key(b);
+    });
+    vector<Edge> changed;
+    vector<int> old;
+    for (size_t k = 0; k < order.size();) {
+        size_t first = order[k];
+        size_t last = first;
+        for (; k < order.size() && edge_key(order[k]) == edge_key(first); k++) {
+            last = order[k];
+        }
+        if (previous[first] == updates[last].weight) {
+            continue;
+        }
+        changed.push_back(updates[last]);
+        old.push_back(previous[first]);
+        if (undirected) {
+            Edge back = {updates[last].v, updates[last].u, updates[last].weight};
+            changed.push_back(back);
+            old.push_back(previous[first]);
+        }
+    }
 
+    // a tree arc that got longer invalidates the subtree below it
+    if (this->affected.empty()) {
+        this->affected.assign(this->G->num_vertices, 0);
+    }
+    vector<vertex_t> invalid;
+    for (size_t i = 0; i < changed.size(); i++) {
+        vertex_t v = changed[i].v;
+        if (changed[i].weight > old[i] && !this->affected[v] && this->predecessor(v) == changed[i].u) {
+            this->affected[v] = 1;
+            invalid.push_back(v);
+        }
+    }
+    const edge_t *offsets = this->G->offsets.data();
+    const vertex_t *targets = this->G->targets.data();
+    for (size_t i = 0; i < invalid.size(); i++) {
+        vertex_t u = invalid[i];
+        for (edge_t e = offsets[u]; e < offsets[u + 1]; e++) {
+            vertex_t w = targets[e];
+            if (!this->affected[w] && this->predecessor(w) == u) {
+                this->affected[w] = 1;
+                invalid.push_back(w);
+            }
+        }
+    }
+    for (size_t i = 0; i < invalid.size(); i++) {
+        vertex_t v = invalid[i];
+        this->distances[v].store(DIST_INF, std::memory_order_relaxed);
+        this->offerKeys[v].store(DIST_INF, std::memory_order_relaxed);
+        this->labels[v].store(make_label(DIST_INF, NO_VERTEX), std::memory_order_relaxed);
     }
 
-    for (long i = 0; i < num_of_threads; i++) {
-        (void) pthread_join(threads[i], NULL);
+    // an invalidated vertex is offered its best key over arcs from outside
+    // the subtree, the head of an arc that got shorter its key over that arc
+    this->seeds.clear();
+    const edge_t *in_offsets = this->R->offsets.data();
+    const vertex_t *sources = this->R->targets.data();
+    const int *in_weights = this->R->weights.data();
+    for (size_t i = 0; i < invalid.size(); i++) {
+        vertex_t v = invalid[i];
+        for (edge_t e = in_offsets[v]; e < in_offsets[v + 1]; e++) {
+            vertex_t u = sources[e];
+            dist_t alt = add_dist(this->distances[u].load(std::memory_order_relaxed), in_weights[e]);
+            if (!this->affected[u] && alt < this->offerKeys[v].load(std::memory_order_relaxed)) {
+                this->offerKeys[v].store(alt, std::memory_order_relaxed);
+                this->labels[v].store(make_label(alt, u), std::memory_order_relaxed);
+            }
+        }
+        if (this->offerKeys[v].load(std::memory_order_relaxed) != DIST_INF) {
+            Offer seed = {v, this->offerKeys[v].load(std::memory_order_relaxed)};
+            this->seeds.push_back(seed);
+        }
     }
+    for (size_t i = 0; i < changed.size(); i++) {
+        vertex_t u = changed[i].u;
+        vertex_t v = changed[i].v;
+        dist_t alt = add_dist(this->distances[u].load(std::memory_order_relaxed), changed[i].weight);
+        if (changed[i].weight < old[i] && !this->affected[u] && alt < this->offerKeys[v].load(std::memory_order_relaxed)) {
+            this->offerKeys[v].store(alt, std::memory_order_relaxed);
+            this->labels[v].store(make_label(alt, u), std::memory_order_relaxed);
+            Offer seed = {v, alt};
+            this->seeds.push_back(seed);
+        }
+    }
+    for (size_t i = 0; i < invalid.size(); i++) {
+        this->affected[invalid[i]] = 0;
+    }
+
+    this->repairing = true;
+    this->run();
+    this->repairing = false;
+    return invalid.size();
+}
 
-    for (auto p : to_delete){
-        delete p;
+
+dist_t DijkstraSolver::query(vertex_t source, vertex_t target) {
+    this->source = source;
+    this->target = target;
+    this->hasTarget = true;
+    this->solved = false;
+    this->run();
+    return this->bidirectional ? this->best.load() : this->offerKeys[target].load();
+}
+
+
+DijkstraSolver::~DijkstraSolver() {
+    this->shutdown = true;
+    pthread_barrier_wait(&this->start);
+    for (int i = 0; i < this->p; i++) {
+        (void) pthread_join(this->threads[i], NULL);
+        delete (ThreadInput *) this->inputs[i];
     }
-    to_delete.clear();
+    pthread_barrier_destroy(&this->start);
+    pthread_barrier_destroy(&this->finish);
+    pthread_barrier_destroy(&this->workers);
+
+    delete[] this->distances;
+    delete[] this->offerKeys;
+    delete[] this->done;
+    delete this->counters;
+    delete this->queue;
+    delete[] this->backDistances;
+    delete[] this->backOfferKeys;
+    delete this->backQueue;
+    delete[] this->labels;
+    delete[] this->backLabels;
+}
 
-    ofstream myFile;
-    myFile.open ("output.txt");
-    for (int i = 0; i < G->vertices.size(); i++) {
-        myFile << distances[i] << std::endl;
+
+vertex_t DijkstraSolver::predecessor(vertex_t v) const {
+    return this->labels ? label_vertex(this->labels[v].load(std::memory_order_relaxed)) : NO_VERTEX;
+}
+
+
+// Follows the labels back from `from` to the start of its search, appending
+// the vertices after `from`. Only the thread that lowers a key to its final
+// value writes that label, after its own vertex got its final key, so the
+// labels form a tree even across zero-weight edges.
+static void follow(const std::atomic<label_t> *labels, vertex_t from, std::vector<vertex_t> *path) {
+    for (vertex_t v = label_vertex(labels[from].load()); v != NO_VERTEX; v = label_vertex(labels[v].load())) {
+        path->push_back(v);
     }
-    myFile.close();
+}
 
-    for(int i=0; i<G->vertices.size(); i++){
-        delete offersLocks[i];
-        delete distancesLocks[i];
-        if (offers[i]){
-//            delete offers[i];
-            Allocator::enterQuiescentState(0);
-            Allocator::free(offers[i], 0);
-            Allocator::leaveQuiescentState(0);
+
+bool DijkstraSolver::path(vertex_t target, std::vector<vertex_t> *path) const {
+    path->clear();
+    if (!this->labels) {
+        return false;
+    }
+    // a bidirectional query's path is the forward tree's path to the meeting
+    // vertex followed by the backward tree's path from it
+    vertex_t last = target;
+    if (this->bidirectional) {
+        if (this->best.load() == DIST_INF) {
+            return false;
         }
+        last = label_vertex(this->meeting.load());
+    } else if (this->offerKeys[target].load() == DIST_INF) {
+        return false;
     }
-    delete[] offersLocks;
-    delete[] distancesLocks;
+    path->push_back(last);
+    follow(this->labels, last, path);
+    std::reverse(path->begin(), path->end());
+    if (this->bidirectional) {
+        follow(this->backLabels, last, path);
+    }
+    return true;
+}
+
 
-    delete queue;
+void dijkstra_shortest_path(Graph *G, int c, int p, bool huge_pages, const ThreadPlacement *placement,
+                            bool predecessors, const OutputOptions &output, StatsFormat stats) {
+
+    DijkstraSolver *solver = new DijkstraSolver(G, c, p, 0, huge_pages, placement, false, predecessors);
+    solver->solve(G->source);
+    print_work_counts(solver->counters->total(), c, p, stats, cout);
+
+    // the results outlive the solver, so they are written while its threads,
+    // queue and record manager are torn down
+    std::atomic<dist_t> *distances = solver->distances;
+    std::atomic<label_t> *labels = solver->labels;
+    solver->distances = NULL;
+    solver->labels = NULL;
+    string extension = output_extension(output.format);
+    thread writer([G, distances, labels, &output, &extension]() {
+        write_distances(G, distances, "output" + extension, output);
+        if (labels) {
+            write_predecessors(G, labels, "predecessors" + extension, output);
+        }
+    });
+
+    delete solver;
+    Allocator::destroy_allocator();
+    writer.join();
+    delete[] distances;
+    delete[] labels;
+}
 
 
+void dijkstra_with_updates(Graph *G, const std::vector< std::vector<Edge> > &batches, int c, int p, bool huge_pages,
+                           const ThreadPlacement *placement, const OutputOptions &output, StatsFormat stats) {
+
+    DijkstraSolver *solver = new DijkstraSolver(G, c, p, 0, huge_pages, placement, false, true);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    solver->solve(G->source);
+    cout << "initial sssp in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+
+    for (size_t b = 0; b < batches.size(); b++) {
+        WorkCounts before = solver->counters->total();
+        start = chrono::steady_clock::now();
+        vertex_t invalidated = solver->update(batches[b]);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        WorkCounts after = solver->counters->total();
+        uint64_t expanded = (after.count[COUNT_POPS] - after.count[COUNT_STALE_POPS]) -
+                            (before.count[COUNT_POPS] - before.count[COUNT_STALE_POPS]);
+        cout << "update " << b << ": " << batches[b].size() << " changes, " << invalidated << " invalidated, "
+             << expanded << " expanded in " << seconds << " s" << endl;
+    }
+    print_work_counts(solver->counters->total(), c, p, stats, cout);
+
+    std::atomic<dist_t> *distances = solver->distances;
+    std::atomic<label_t> *labels = solver->labels;
+    solver->distances = NULL;
+    solver->labels = NULL;
+    string extension = output_extension(output.format);
+    thread writer([G, distances, labels, &output, &extension]() {
+        write_distances(G, distances, "output" + extension, output);
+        write_predecessors(G, labels, "predecessors" + extension, output);
+    });
+
+    delete solver;
+    Allocator::destroy_allocator();
+    writer.join();
+    delete[] distances;
+    delete[] labels;
 }
 
 
+// Compares found with reference, printing the first mismatching vertices,
+// and returns the number of mismatches.
+static vertex_t count_mismatches(const Graph *G, const std::atomic<dist_t> *found, const dist_t *reference) {
+    vector<uint64_t> ids = file_ids(G);
+    vertex_t mismatches = 0;
+    for (vertex_t v = 0; v < G->num_vertices; v++) {
+        dist_t d = found[v].load(std::memory_order_relaxed);
+        if (d == reference[v]) {
+            continue;
+        }
+        if (mismatches++ < 10) {
+            cout << "vertex " << ids[v] << ": multiqueues " << d << ", sequential " << reference[v] << endl;
+        }
+    }
+    return mismatches;
+}
+
+
+#define VALIDATION_UPDATES 8
+
+// Repairs a solve after a batch that sets each of a few tree arcs twice:
+// first lower, then higher than before, the second time from the other end
+// on an undirected graph. Only the final weight may count. G keeps the
+// batch's weights.
+static bool validate_repair(Graph *G, int c, int p, bool huge_pages, const ThreadPlacement *placement) {
+    if (G->backward() == NULL) {
+        G->build_reverse(p);
+        G->reverse->remove_parallel_edges(p);
+    }
+    DijkstraSolver *solver = new DijkstraSolver(G, c, p, 0, huge_pages, placement, false, true);
+    solver->solve(G->source);
+
+    vector<Edge> batch;
+    vertex_t n = G->num_vertices;
+    for (int i = 0; i < VALIDATION_UPDATES; i++) {
+        vertex_t v = (vertex_t) ((uint64_t) n * (2 * i + 1) / (2 * VALIDATION_UPDATES));
+        vertex_t u = solver->predecessor(v);
+        edge_t e;
+        if (u == NO_VERTEX || !G->find_arc(u, v, &e)) {
+            continue;
+        }
+        int w = G->weights[e];
+        Edge lower = {u, v, w / 2};
+        Edge higher = {u, v, w < (DELETED_WEIGHT - 1) / 2 ? 2 * w + 1 : DELETED_WEIGHT - 1};
+        if (!G->directed) {
+            swap(higher.u, higher.v);
+        }
+        batch.push_back(lower);
+        batch.push_back(higher);
+    }
+    solver->update(batch);
+
+    SequentialDijkstra reference(G);
+    reference.solve(G->source);
+    vertex_t mismatches = count_mismatches(G, solver->distances, reference.distances.data());
+    if (mismatches) {
+        cout << "repair validation failed: " << mismatches << " of " << n << " distances differ after "
+             << batch.size() << " updates" << endl;
+    } else {
+        cout << "repair validation passed: all " << n << " distances match after " << batch.size() << " updates"
+             << endl;
+    }
+    delete solver;
+    return mismatches == 0;
+}
+
+
+bool validate_shortest_path(Graph *G, int c, int p, bool huge_pages, const ThreadPlacement *placement,
+                            StatsFormat stats) {
+
+    // the parallel search runs first, so only the sequential one finds the
+    // graph already in cache: the speedup errs low
+    DijkstraSolver *solver = new DijkstraSolver(G, c, p, 0, huge_pages, placement);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    solver->solve(G->source);
+    double parallel_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    print_work_counts(solver->counters->total(), c, p, stats, cout);
+
+    SequentialDijkstra reference(G);
+    start = chrono::steady_clock::now();
+    reference.solve(G->source);
+    double sequential_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "sequential dijkstra in " << sequential_s << " s, multiqueues in " << parallel_s << " s (" << p
+         << " threads, c = " << c << ", " << relax_kernel_name(solver->kernel) << " relax): speedup "
+         << sequential_s / parallel_s << endl;
+
+    vertex_t mismatches = count_mismatches(G, solver->distances, reference.distances.data());
+    if (mismatches) {
+        cout << "validation failed: " << mismatches << " of " << G->num_vertices << " distances differ" << endl;
+    } else {
+        cout << "validation passed: all " << G->num_vertices << " distances match" << endl;
+    }
+    delete solver;
+
+    bool repaired = validate_repair(G, c, p, huge_pages, placement);
+    Allocator::destroy_allocator();
+    return mismatches == 0 && repaired;
+}
+
+
+void dijkstra_point_to_point(Graph *G, vertex_t target, int c, int p, bool bidirectional, const Heuristic *heuristic,
+                             bool huge_pages, const ThreadPlacement *placement, bool predecessors,
+                             StatsFormat stats) {
+
+    DijkstraSolver *solver = new DijkstraSolver(G, c, p, 0, huge_pages, placement, bidirectional, predecessors);
+    solver->heuristic = heuristic;
+    dist_t distance = solver->query(G->source, target);
+
+    if (distance == DIST_INF) {
+        cout << "target unreachable" << endl;
+    } else {
+        cout << "distance " << distance << endl;
+    }
+    print_work_counts(solver->counters->total(), c, p, stats, cout);
+    vector<vertex_t> path;
+    if (solver->path(target, &path)) {
+        vector<uint64_t> ids = file_ids(G);
+        cout << "path";
+        for (size_t i = 0; i < path.size(); i++) {
+            cout << " " << ids[path[i]];
+        }
+        cout << endl;
+    }
+
+    delete solver;
+    Allocator::destroy_allocator();
+}
+
+
+void batch_shortest_paths(Graph *G, const std::vector<Query> &queries, int c, int p, int concurrent, bool bidirectional,
+                          const Heuristic *heuristic, bool huge_pages, const ThreadPlacement *placement,
+                          const std::string &outDir, bool predecessors, const OutputOptions &output,
+                          StatsFormat stats) {
+
+    concurrent = max(1, min(concurrent, p));
+    Allocator::init_allocator(p);
+
+    // solver k gets threads [first, first + size) of the p
+    vector<DijkstraSolver*> solvers;
+    for (int k = 0; k < concurrent; k++) {
+        int first = p * k / concurrent;
+        int size = p * (k + 1) / concurrent - first;
+        solvers.push_back(new DijkstraSolver(G, c, size, first, huge_pages, placement, bidirectional, predecessors));
+        solvers.back()->heuristic = heuristic;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    atomic<size_t> next(0);
+    atomic<size_t> failed(0);
+    vector<dist_t> answers(queries.size(), DIST_INF);
+    vector<vector<vertex_t> > paths(predecessors ? queries.size() : 0);
+    vector<thread> controllers;
+    for (int k = 0; k < concurrent; k++) {
+        DijkstraSolver *solver = solvers[k];
+        controllers.push_back(thread([G, solver, &queries, &answers, &paths, &next, &failed, &outDir, &output]() {
+            // the solver's workers are idle while its results are written
+            OutputOptions options = output;
+            options.numOfThreads = solver->p;
+            string extension = output_extension(output.format);
+            for (size_t i = next++; i < queries.size(); i = next++) {
+                vertex_t source, target;
+                bool pair = queries[i].target != NO_TARGET;
+                if (!G->from_file_id(queries[i].source, &source) ||
+                    (pair && !G->from_file_id(queries[i].target, &target))) {
+                    failed++;
+                    continue;
+                }
+                if (pair) {
+                    answers[i] = solver->query(source, target);
+                    if (solver->labels) {
+                        solver->path(target, &paths[i]);
+                    }
+                } else if (solver->bidirectional) {
+                    failed++;
+                } else {
+                    solver->solve(source);
+                    if (!outDir.empty()) {
+                        string name = outDir + "/" + to_string(queries[i].source);
+                        write_distances(G, solver->distances, name + extension, options);
+                        if (solver->labels) {
+                            write_predecessors(G, solver->labels, name + ".pred" + extension, options);
+                        }
+                    }
+                }
+            }
+        }));
+    }
+    for (size_t k = 0; k < controllers.size(); k++) {
+        controllers[k].join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (failed) {
+        cerr << "skipped " << failed << " queries with out-of-range vertices"
+             << (bidirectional ? " or without a target" : "") << endl;
+    }
+    size_t answered = queries.size() - failed;
+    cout << "answered " << answered << " queries in " << seconds << " s (" << answered / seconds
+         << " queries/s, " << concurrent << " concurrent, " << p / concurrent << "+ threads each)" << endl;
+
+    WorkCounts work;
+    for (size_t k = 0; k < solvers.size(); k++) {
+        work.add(solvers[k]->counters->total());
+    }
+    print_work_counts(work, c, p, stats, cout);
+
+    if (!outDir.empty()) {
+        write_pairs(queries, answers, outDir + "/pairs.txt");
+        if (predecessors) {
+            write_paths(G, queries, answers, paths, outDir + "/paths.txt");
+        }
+    }
+
+    for (size_t k = 0; k < solvers.size(); k++) {
+        delete solvers[k];
+    }
+    Allocator::destroy_allocator();
+}
@@ -5,11 +5,160 @@
 #ifndef MULTIQUEUE_DIJKSTRA_HPP
 #define MULTIQUEUE_DIJKSTRA_HPP
 
+#include <string>
+#include <vector>
+#include <atomic>
+#include <pthread.h>
 #include "Graph.h"
 #include "MultiQueues.h"
 #include "Allocator.h" //todo edit includes all project
+#include "Affinity.h"
+#include "Heuristic.h"
+#include "Distances.h"
+#include "Counters.h"
+#include "BatchRelax.h"
 
-void dijkstra_shortest_path(Graph *G, int c, int p);
+#define PREFETCH_DISTANCE 4      // default DijkstraSolver::prefetchDistance
+
+// A MultiQueues-driven Dijkstra whose worker threads, queue and per-vertex
+// arrays are created once and reused for every query. Workers use record
+// manager tids firstTid .. firstTid + p - 1, so several solvers can run side
+// by side once Allocator::init_allocator has been called for all of them.
+//
+// A bidirectional solver also keeps a second queue and second arrays for the
+// backward search from the target; it only answers point-to-point queries.
+//
+// With a heuristic, a one-sided point-to-point query runs A*: every key is
+// g(v) + h(v), and distances[] and offerKeys[] hold keys rather than path
+// lengths. Keys of one vertex differ by a constant, so settling and pruning
+// are unchanged, and the target's key is its distance since h(target) = 0.
+//
+// A solver built with predecessors = true also records, next to every key it
+// offers, the vertex that offered it (see label_t), so the last query's
+// shortest paths can be read back with path(). Such a solver can also bring
+// the result of solve() up to date after edge weight changes with update(),
+// which repairs only the vertices whose distance may have changed.
+class DijkstraSolver {
+    public:
+        // While relaxing the arcs of a vertex, the distance and offer key of
+        // the target this many arcs ahead are prefetched; 0 turns it off.
+        // Shared by every solver, set before they run.
+        static int prefetchDistance;
+        // How arcs are screened before relax (see BatchRelax.h); every solver
+        // built afterwards uses it, falling back to scalar where unsupported.
+        static RelaxKernel relaxKernel;
+
+        DijkstraSolver(Graph *G, int c, int p, int firstTid = 0, bool huge_pages = false,
+                       const ThreadPlacement *placement = NULL, bool bidirectional = false,
+                       bool predecessors = false);
+        ~DijkstraSolver();
+
+        // distances from source (an id of G) into distances[]
+        void solve(vertex_t source);
+        // length of a shortest source - target path, DIST_INF if there is none.
+        // Stops as soon as no pending offer can still shorten it.
+        dist_t query(vertex_t source, vertex_t target);
+
+        // offers with a key at or above this cannot improve the answer
+        dist_t bound() const;
+
+        // the vertex before v on its shortest path from the last source,
+        // NO_VERTEX for the source, unreached vertices or without predecessors
+        vertex_t predecessor(vertex_t v) const;
+        // The vertices of a shortest path of the last query, source first: to
+        // target after solve(), to the query's own target after query().
+        // False (and an empty path) if target was not reached or predecessors
+        // are not recorded.
+        bool path(vertex_t target, std::vector<vertex_t> *path) const;
+
+        // Applies the weight changes (see Graph::update_arcs) and repairs the
+        // distances and predecessors of the last solve(). Vertices whose
+        // shortest-path tree branch got longer lose their distance and are
+        // offered again from their unaffected in-neighbors, heads of arcs that
+        // got shorter are offered their new key, and the search runs from
+        // there. Needs predecessors and the in-arcs of G (G->backward()).
+        // Returns the number of vertices whose distance was invalidated.
+        vertex_t update(const std::vector<Edge> &updates);
+
+        Graph *G;
+        Graph *R;                       // graph searched backwards: G->backward()
+        int p;
+        int firstTid;
+        const ThreadPlacement *placement;
+        bool bidirectional;
+        MultiQueues *queue;
+        std::atomic<dist_t> *distances;
+        std::atomic<dist_t> *offerKeys;   // smallest key offered for each vertex in this query
+        MultiQueues *backQueue;           // backward search, NULL unless bidirectional
+        std::atomic<dist_t> *backDistances;
+        std::atomic<dist_t> *backOfferKeys;
+        std::atomic<dist_t> best;         // shortest path through a vertex reached from both sides
+        std::atomic<label_t> *labels;     // offerKeys and who offered them, NULL without predecessors
+        std::atomic<label_t> *backLabels;
+        std::atomic<label_t> meeting;     // best and the vertex it goes through
+        const Heuristic *heuristic;       // one-sided point-to-point queries run A* with it, if set
+        std::atomic<bool> *done;
+        WorkCounters *counters;           // per worker, summed over every query so far
+        RelaxKernel kernel;               // relaxKernel as resolved for this CPU and graph
+        ImprovingArcs improving;          // its screen, NULL for one arc at a time
+        int relaxWidth;                   // arcs per call of improving
+        vertex_t source;
+        vertex_t target;
+        bool hasTarget;
+        bool shutdown;
+        bool repairing;                 // the next run starts from seeds and keeps the last distances
+        std::vector<Offer> seeds;
+
+        pthread_barrier_t start;        // controller + workers, a query (or shutdown) is ready
+        pthread_barrier_t finish;       // controller + workers, the query is answered
+        pthread_barrier_t workers;      // workers only
+
+    private:
+        void run();
+        bool solved;                    // the last query was a solve()
+        std::vector<char> affected;     // update() scratch, all 0 between calls
+        std::vector<pthread_t> threads;
+        std::vector<void*> inputs;
+};
+
+// Writes the distances to output.txt (output.bin in a binary format) and,
+// with predecessors, the shortest-path tree to predecessors.txt (.bin).
+// All three print the solvers' work counts in the given format at the end.
+void dijkstra_shortest_path(Graph *G, int c, int p, bool huge_pages = false, const ThreadPlacement *placement = NULL,
+                            bool predecessors = false, const OutputOptions &output = OutputOptions(),
+                            StatsFormat stats = STATS_NONE);
+// prints the distance from G->source to target (an id of G) and, with
+// predecessors, the path as file ids
+void dijkstra_point_to_point(Graph *G, vertex_t target, int c, int p, bool bidirectional, const Heuristic *heuristic,
+                             bool huge_pages = false, const ThreadPlacement *placement = NULL,
+                             bool predecessors = false, StatsFormat stats = STATS_NONE);
+// Solves from G->source, then applies each batch of weight changes with
+// DijkstraSolver::update and reports how long it took and how much of the
+// graph it touched, before writing the final distances like
+// dijkstra_shortest_path.
+void dijkstra_with_updates(Graph *G, const std::vector< std::vector<Edge> > &batches, int c, int p,
+                           bool huge_pages = false, const ThreadPlacement *placement = NULL,
+                           const OutputOptions &output = OutputOptions(), StatsFormat stats = STATS_NONE);
+// Solves from G->source with the MultiQueues solver and with
+// SequentialDijkstra, compares the two distance arrays and reports both
+// times and the speedup over the sequential search. Then checks update()
+// the same way, after a batch that sets some tree arcs twice; G keeps that
+// batch's weights. Returns true if every distance matches both times.
+bool validate_shortest_path(Graph *G, int c, int p, bool huge_pages = false, const ThreadPlacement *placement = NULL,
+                            StatsFormat stats = STATS_NONE);
 void *parallel_Dijkstra(void *void_input);
 
+// Answers every query while loading the graph, allocating the queues and
+// starting the threads once. The p threads are split into `concurrent`
+// solvers that take queries from a shared counter. With a non-empty outDir,
+// the distances for a full query from s go to outDir/s.txt (s.bin in a binary
+// output format) and the answers to point-to-point queries to
+// outDir/pairs.txt, one "s t distance" line each.
+// With predecessors, full queries also write outDir/s.pred.txt and the
+// point-to-point answers go to outDir/paths.txt with their paths.
+void batch_shortest_paths(Graph *G, const std::vector<Query> &queries, int c, int p, int concurrent, bool bidirectional,
+                          const Heuristic *heuristic, bool huge_pages, const ThreadPlacement *placement,
+                          const std::string &outDir, bool predecessors = false,
+                          const OutputOptions &output = OutputOptions(), StatsFormat stats = STATS_NONE);
+
 #endif //MULTIQUEUE_DIJKSTRA_HPP
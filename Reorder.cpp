@@ -0,0 +1,203 @@
+#include "Reorder.h"
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+
+bool parse_vertex_order(const std::string &name, VertexOrder *order) {
+    if (name == "none") {
+        *order = ORDER_NONE;
+    } else if (name == "bfs") {
+        *order = ORDER_BFS;
+    } else if (name == "rcm") {
+        *order = ORDER_RCM;
+    } else if (name == "degree") {
+        *order = ORDER_DEGREE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+// Appends to sequence the vertices reachable from root in breadth-first order.
+// With by_degree, the unvisited neighbors of each vertex are queued from the
+// lowest degree up (Cuthill-McKee).
+static void bfs_from(const Graph &G, vertex_t root, bool by_degree, vector<bool> &visited, vector<vertex_t> &sequence) {
+    size_t head = sequence.size();
+    vector< pair<edge_t, vertex_t> > frontier;
+
+    visited[root] = true;
+    sequence.push_back(root);
+    while (head < sequence.size()) {
+        vertex_t v = sequence[head++];
+        frontier.clear();
+        for (edge_t e = G.offsets[v]; e < G.offsets[v + 1]; e++) {
+            vertex_t u = G.targets[e];
+            if (!visited[u]) {
+                visited[u] = true;
+                frontier.push_back(make_pair(by_degree ? G.degree(u) : 0, u));
+            }
+        }
+        if (by_degree) {
+            sort(frontier.begin(), frontier.end());
+        }
+        for (size_t i = 0; i < frontier.size(); i++) {
+            sequence.push_back(frontier[i].second);
+        }
+    }
+}
+
+// A vertex at the far end of root's component: repeatedly jump to a
+// lowest-degree vertex of the deepest BFS level while that increases the
+// depth. level must hold UNSEEN everywhere and is restored before returning.
+static const vertex_t UNSEEN = (vertex_t) -1;
+
+static vertex_t peripheral_vertex(const Graph &G, vertex_t root, vector<vertex_t> &level) {
+    vector<vertex_t> queue;
+    vertex_t depth = 0;
+    for (int round = 0; round < 4; round++) {
+        queue.clear();
+        queue.push_back(root);
+        level[root] = 0;
+        vertex_t last = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            vertex_t v = queue[head];
+            for (edge_t e = G.offsets[v]; e < G.offsets[v + 1]; e++) {
+                vertex_t u = G.targets[e];
+                if (level[u] == UNSEEN) {
+                    level[u] = level[v] + 1;
+                    last = level[u];
+                    queue.push_back(u);
+                }
+            }
+        }
+        vertex_t next = root;
+        for (size_t i = 0; i < queue.size(); i++) {
+            vertex_t v = queue[i];
+            if (level[v] == last && (next == root || G.degree(v) < G.degree(next))) {
+                next = v;
+            }
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            level[queue[i]] = UNSEEN;
+        }
+        if (round > 0 && last <= depth) {
+            break;
+        }
+        depth = last;
+        root = next;
+    }
+    return root;
+}
+
+
+// Rebuilds the adjacency of G with vertex sequence[i] renamed to i (new_id is
+// the inverse), each list translated and sorted by target.
+static void relabel_adjacency(Graph *G, const vector<vertex_t> &sequence, const vector<vertex_t> &new_id,
+                              int numOfThreads) {
+    vertex_t n = G->num_vertices;
+    GraphArray<edge_t> offsets;
+    GraphArray<vertex_t> targets;
+    GraphArray<int> weights;
+    offsets.resize((size_t) n + 1);
+    targets.resize(G->num_edges());
+    weights.resize(G->num_edges());
+    offsets[0] = 0;
+    for (vertex_t i = 0; i < n; i++) {
+        offsets[i + 1] = offsets[i] + G->degree(sequence[i]);
+    }
+
+    vector<thread> workers;
+    for (int t = 0; t < numOfThreads; t++) {
+        vertex_t first = (vertex_t) ((uint64_t) n * t / numOfThreads);
+        vertex_t last = (vertex_t) ((uint64_t) n * (t + 1) / numOfThreads);
+        workers.push_back(thread([G, &sequence, &new_id, &offsets, &targets, &weights, first, last]() {
+            vector< pair<vertex_t, int> > adjacency;
+            for (vertex_t i = first; i < last; i++) {
+                vertex_t v = sequence[i];
+                adjacency.clear();
+                for (edge_t e = G->offsets[v]; e < G->offsets[v + 1]; e++) {
+                    adjacency.push_back(make_pair(new_id[G->targets[e]], G->weights[e]));
+                }
+                sort(adjacency.begin(), adjacency.end());
+                edge_t out = offsets[i];
+                for (size_t k = 0; k < adjacency.size(); k++, out++) {
+                    targets[out] = adjacency[k].first;
+                    weights[out] = adjacency[k].second;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    G->offsets.swap(offsets);
+    G->targets.swap(targets);
+    G->weights.swap(weights);
+}
+
+
+void reorder_graph(Graph *G, VertexOrder order, int numOfThreads) {
+    vertex_t n = G->num_vertices;
+    if (order == ORDER_NONE || n == 0) {
+        return;
+    }
+
+    // sequence[new id] = current id
+    vector<vertex_t> sequence;
+    sequence.reserve(n);
+    if (order == ORDER_DEGREE) {
+        for (vertex_t v = 0; v < n; v++) {
+            sequence.push_back(v);
+        }
+        stable_sort(sequence.begin(), sequence.end(), [G](vertex_t a, vertex_t b) {
+            return G->degree(a) > G->degree(b);
+        });
+    } else {
+        vector<bool> visited(n, false);
+        vector<vertex_t> level(order == ORDER_RCM ? n : 0, UNSEEN);
+        if (order == ORDER_BFS) {
+            bfs_from(*G, G->source, false, visited, sequence);
+        }
+        for (vertex_t v = 0; v < n; v++) {
+            if (!visited[v]) {
+                vertex_t root = order == ORDER_RCM ? peripheral_vertex(*G, v, level) : v;
+                // along out-arcs, v may reach an earlier component's vertices
+                if (visited[root]) {
+                    root = v;
+                }
+                bfs_from(*G, root, order == ORDER_RCM, visited, sequence);
+                // ... and the root it reaches need not lead back to v
+                if (!visited[v]) {
+                    bfs_from(*G, v, order == ORDER_RCM, visited, sequence);
+                }
+            }
+        }
+        if (order == ORDER_RCM) {
+            reverse(sequence.begin(), sequence.end());
+        }
+    }
+
+    assert(sequence.size() == n);
+    vector<vertex_t> new_id(n);
+    for (vertex_t i = 0; i < n; i++) {
+        new_id[sequence[i]] = i;
+    }
+
+    relabel_adjacency(G, sequence, new_id, numOfThreads);
+    if (G->reverse) {
+        relabel_adjacency(G->reverse, sequence, new_id, numOfThreads);
+        G->reverse->source = new_id[G->reverse->source];
+    }
+    G->source = new_id[G->source];
+    if (G->relabel.empty()) {
+        G->relabel.swap(new_id);
+    } else {
+        // compose with an earlier relabeling
+        for (size_t i = 0; i < G->relabel.size(); i++) {
+            G->relabel[i] = new_id[G->relabel[i]];
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef MULTIQUEUE_REORDER_H
+#define MULTIQUEUE_REORDER_H
+
+#include <string>
+#include "Graph.h"
+
+enum VertexOrder {
+    ORDER_NONE,
+    ORDER_BFS,          // breadth-first from the source, remaining components after it
+    ORDER_RCM,          // reverse Cuthill-McKee, per component from a low-degree peripheral vertex
+    ORDER_DEGREE        // by decreasing degree, hubs first
+};
+
+// Parses "none", "bfs", "rcm" or "degree". Returns false for anything else.
+bool parse_vertex_order(const std::string &name, VertexOrder *order);
+
+// Relabels the vertices of G in the given order and sorts every adjacency by
+// target id, so that vertices explored together sit close in the distance
+// array. G->relabel records the mapping from the file's ids. A reverse graph
+// is relabeled along with G; directed graphs are traversed along out-arcs.
+void reorder_graph(Graph *G, VertexOrder order, int numOfThreads);
+
+#endif //MULTIQUEUE_REORDER_H
@@ -0,0 +1,75 @@
+#include "SequentialDijkstra.h"
+#include "Heap.h"
+
+using namespace std;
+
+
+SequentialDijkstra::SequentialDijkstra(const Graph *G) {
+    this->G = G;
+    this->heap = new dAryMinHeap(HEAP_MIN_CAPACITY);
+    this->distances.resize(G->num_vertices);
+}
+
+
+SequentialDijkstra::~SequentialDijkstra() {
+    delete this->heap;
+}
+
+
+void SequentialDijkstra::push(vertex_t v, dist_t d) {
+    Offer *offer;
+    if (this->spare.empty()) {
+        this->pool.push_back(Offer());
+        offer = &this->pool.back();
+    } else {
+        offer = this->spare.back();
+        this->spare.pop_back();
+    }
+    offer->vertex = v;
+    offer->dist = d;
+    this->heap->insert(offer);
+}
+
+
+void SequentialDijkstra::solve(vertex_t source) {
+    const edge_t *offsets = this->G->offsets.data();
+    const vertex_t *targets = this->G->targets.data();
+    const int *weights = this->G->weights.data();
+    dist_t *dist = this->distances.data();
+
+    fill(this->distances.begin(), this->distances.end(), DIST_INF);
+    this->heap->clear();
+    this->spare.clear();
+    for (size_t i = 0; i < this->pool.size(); i++) {
+        this->spare.push_back(&this->pool[i]);
+    }
+
+    dist[source] = 0;
+    this->push(source, 0);
+
+    while (!this->heap->isEmpty()) {
+        Offer *min = this->heap->extractMin();
+        vertex_t u = min->vertex;
+        dist_t d = min->dist;
+        this->spare.push_back(min);
+        if (d > dist[u]) {
+            continue;
+        }
+        for (edge_t e = offsets[u]; e < offsets[u + 1]; e++) {
+            vertex_t v = targets[e];
+            dist_t alt = add_dist(d, weights[e]);
+            if (alt >= dist[v]) {
+                continue;
+            }
+            dist[v] = alt;
+            this->push(v, alt);
+        }
+    }
+}
+
+
+void sequential_shortest_path(Graph *G, const OutputOptions &output) {
+    SequentialDijkstra solver(G);
+    solver.solve(G->source);
+    write_distances(G, solver.distances.data(), "output" + string(output_extension(output.format)), output);
+}
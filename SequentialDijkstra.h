@@ -0,0 +1,39 @@
+#ifndef MULTIQUEUE_SEQUENTIALDIJKSTRA_H
+#define MULTIQUEUE_SEQUENTIALDIJKSTRA_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include "Graph.h"
+#include "dAryMinHeap.h"
+#include "Distances.h"
+
+// Dijkstra on the calling thread with a single dAryMinHeap: no locks, no
+// record manager and no atomic per-vertex state. An improved vertex is pushed
+// again rather than decreased, and stale entries are skipped when popped.
+// Popped offers are kept for later pushes, so a search allocates only while
+// its heap grows. The reference that the parallel engines are checked and
+// timed against.
+class SequentialDijkstra {
+    public:
+        SequentialDijkstra(const Graph *G);
+        ~SequentialDijkstra();
+
+        // distances from source (an id of G) into distances[]
+        void solve(vertex_t source);
+
+        std::vector<dist_t> distances;
+
+    private:
+        const Graph *G;
+        dAryMinHeap *heap;
+        std::deque<Offer> pool;
+        std::vector<Offer*> spare;      // offers of the pool that are not in the heap
+        void push(vertex_t v, dist_t d);
+};
+
+// Solves from G->source and writes the distances to output.txt (output.bin)
+// like dijkstra_shortest_path.
+void sequential_shortest_path(Graph *G, const OutputOptions &output = OutputOptions());
+
+#endif //MULTIQUEUE_SEQUENTIALDIJKSTRA_H
@@ -6,8 +6,9 @@
 #include "Heap.h"//todo remove
 #include "Allocator.h"
 
-dAryMinHeap::dAryMinHeap(int capacity) {
-    this->heap = new ::Heap(capacity, D);
+dAryMinHeap::dAryMinHeap(int capacity, bool huge_pages) {
+    this->heap = new ::Heap(capacity, D, huge_pages);
+    this->top.store(DIST_INF, std::memory_order_relaxed);
 }
 
 
@@ -20,17 +21,18 @@ void dAryMinHeap:: insert(Offer *offer) {
 
     heap->heap_size++;
 
-    int dist = offer->dist;
+    dist_t dist = offer->dist;
     heap->elements[heap->heap_size - 1] = offer;
-    offer->dist = INT_MAX;
+    offer->dist = DIST_INF;
     int i = this->decreaseKey(heap->heap_size - 1, dist);
     heap->elements[i] = offer;
     offer->dist=dist;
+    this->updateTop();
 
 }
 
 
-int dAryMinHeap:: decreaseKey(int i, int dist) {
+int dAryMinHeap:: decreaseKey(int i, dist_t dist) {
 
     if (dist > heap->elements[i]->dist) {
         std::cerr << "new key is larger than current key" << std::endl;
@@ -73,6 +75,8 @@ Offer* dAryMinHeap:: extractMin() {
     heap->heap_size--;
 
     this->minHeapify(0);
+    heap->shrink_if_sparse();
+    this->updateTop();
 
     return min_offer;
 }
@@ -88,6 +92,24 @@ Offer* dAryMinHeap::findMin() {
     return this->heap->elements[0];
 }
 
+void dAryMinHeap::updateTop() {
+    dist_t key = this->isEmpty() ? DIST_INF : this->heap->elements[0]->dist;
+    this->top.store(key, std::memory_order_relaxed);
+}
+
+// Unlike findMin, safe to call without holding the queue's lock: it never
+// touches the element array, which insert/extractMin may move or unmap.
+dist_t dAryMinHeap::minKey() {
+    return this->top.load(std::memory_order_relaxed);
+}
+
+// Forgets every element without touching them; for heaps whose offers are
+// owned by the caller, such as a local search reusing one heap.
+void dAryMinHeap::clear() {
+    this->heap->heap_size = 0;
+    this->updateTop();
+}
+
 dAryMinHeap::~dAryMinHeap() {
     delete this->heap;
 }
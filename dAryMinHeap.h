@@ -10,6 +10,7 @@
 #include<cstdio>
 #include<climits>
 #include <sys/types.h>
+#include <atomic>
 
 #define PARENT(i,d) ((i - 1) / d)
 #define CHILD(i,c,d) (d * i + c + 1)
@@ -17,24 +18,28 @@
 
 
 struct Offer {
-    Vertex* vertex;
-    int dist;
+    vertex_t vertex;
+    dist_t dist;
 };
 
 
 class dAryMinHeap {
 
     public:
-        dAryMinHeap(int capacity);
+        dAryMinHeap(int capacity, bool huge_pages = false);
         Offer* extractMin();
         void insert(Offer *offer);
         bool isEmpty();
         Offer* findMin();
+        dist_t minKey();
+        void clear();
         ~dAryMinHeap();
 
     private:
         Heap* heap;
-        int decreaseKey(int i, int dist);
+        std::atomic<dist_t> top;   // key of elements[0], DIST_INF when empty
+        void updateTop();
+        int decreaseKey(int i, dist_t dist);
         void minHeapify(int i);
 
 
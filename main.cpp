@@ -3,96 +3,512 @@
 #include "MultiQueues.h"
 #include <thread>
 #include <unistd.h>
+#include <getopt.h>
 #include <fstream>
 #include <string>
+#include <sstream>
 #include <stdlib.h>
 #include "Graph.h"
 #include "ParallelDijkstra.h"
+#include "GraphLoader.h"
+#include "Reorder.h"
+#include "Affinity.h"
+#include "DeltaStepping.h"
+#include "Heuristic.h"
+#include "ContractionHierarchy.h"
+#include "Generator.h"
+#include "SequentialDijkstra.h"
+#include <chrono>
 
 using namespace std;
-#define NUM_OF_THREADS 80
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " [options] <graph file> <tuning parameter>" << endl
+         << "       " << prog << " [options] -g <model[:key=value,...]> <tuning parameter>" << endl
+         << "  -g, --generate <spec> generate the graph instead of loading one: rmat, grid2d, grid3d, geometric" << endl
+         << "                        or er, with keys n, scale, degree, weights, min, max, seed (see README)" << endl
+         << "  -f, --format <name>   edgelist, dimacs, snap, metis, binary or auto (default)" << endl
+         << "  -s, --source <id>     source vertex, in the file's own numbering" << endl
+         << "  -D, --directed        keep arcs as given instead of making every edge undirected" << endl
+         << "  -I, --incoming        directed: search along in-arcs, i.e. distances to the source" << endl
+         << "  -T, --target <id>     only find the distance to this vertex (file numbering)" << endl
+         << "  -B, --bidirectional   point-to-point: search from the source and the target at once" << endl
+         << "  -c, --coordinates <f> vertex coordinates (DIMACS .co or \"id x y\" lines) for A*" << endl
+         << "  -A, --heuristic <h>   point-to-point A* bound: euclidean (default with -c), haversine or none" << endl
+         << "  -L, --landmarks <k>   select k landmarks and run point-to-point queries as ALT (A* with landmark bounds)" << endl
+         << "  -l, --landmark-file <f> with -L, save the landmark table to f; without, load it from f" << endl
+         << "  -C, --contract        build a contraction hierarchy and answer point-to-point queries on it" << endl
+         << "  -K, --hierarchy-file <f> with -C, save the hierarchy to f; without, load it from f" << endl
+         << "  -U, --updates <file>  after the search, apply \"u v w\" weight changes (w = -1 deletes; a blank line" << endl
+         << "                        ends a batch) and repair the distances after each batch" << endl
+         << "  -P, --predecessors    also record the shortest-path tree: predecessors.txt, the path to -T, d/paths.txt" << endl
+         << "  -r, --reorder <order> relabel vertices before the search: none (default), bfs, rcm or degree" << endl
+         << "  -t, --threads <n>     worker threads (default: hardware concurrency)" << endl
+         << "  -a, --affinity <p>    thread pinning: none (default), compact, scatter or a core list like 0,2,4-7" << endl
+         << "  -F, --prefetch <k>    prefetch the state of the target k arcs ahead while relaxing (default 4, 0: off)" << endl
+         << "  -x, --simd <kernel>   screen arcs before relaxing: auto (default), scalar, avx2 or avx512" << endl
+         << "  -H, --huge-pages      back large queue heaps with transparent huge pages" << endl
+         << "  -e, --engine <name>   multiqueues (default): relaxed-queue Dijkstra; delta: delta-stepping;" << endl
+         << "                        sequential: one-thread Dijkstra with a single heap" << endl
+         << "  -V, --validate        check the multiqueues distances against sequential Dijkstra, report the speedup" << endl
+         << "  -d, --delta <width>   delta-stepping bucket width (default: chosen from the graph)" << endl
+         << "  -b, --batch <file>    answer one query per \"source [target]\" line of file (file numbering)" << endl
+         << "  -j, --concurrent <k>  batch: run k queries at once, each on p/k threads (default 1)" << endl
+         << "  -o, --output-dir <d>  batch: write the distances for source s to d/s.txt, pairs to d/pairs.txt" << endl
+         << "  -S, --stats <f>       print work counters (pops, stale pops, relaxations, ...): summary or json" << endl
+         << "  -O, --output-format <f> text (default), binary (raw values, .bin) or mmap (the same, through a mapping)" << endl;
+}
 
 int main(int argc,  char *argv[]) {
 
-    string pathToFile = argv[1];
-    ifstream f;
-    f.open (pathToFile);
-    if (!f) {
-        cerr << "Unable to open file " + pathToFile;
+    LoadOptions loadOptions;
+    bool incoming = false;
+    VertexOrder order = ORDER_NONE;
+    int numOfThreads = max((int) thread::hardware_concurrency(), 1);
+    ThreadPlacement placement;
+    bool hugePages = false;
+    bool deltaStepping = false;
+    bool sequential = false;
+    bool validate = false;
+    dist_t delta = 0;
+    string batchFile;
+    string outDir;
+    int concurrent = 1;
+    long long target = -1;
+    bool bidirectional = false;
+    string coordinatesFile;
+    HeuristicKind heuristicKind = HEURISTIC_EUCLIDEAN;
+    int numOfLandmarks = 0;
+    string landmarkFile;
+    bool contract = false;
+    string hierarchyFile;
+    bool predecessors = false;
+    string updatesFile;
+    string generatorSpec;
+    OutputOptions output;
+    StatsFormat stats = STATS_NONE;
+
+    static struct option longOptions[] = {
+        {"format", required_argument, NULL, 'f'},
+        {"generate", required_argument, NULL, 'g'},
+        {"source", required_argument, NULL, 's'},
+        {"directed", no_argument, NULL, 'D'},
+        {"incoming", no_argument, NULL, 'I'},
+        {"target", required_argument, NULL, 'T'},
+        {"bidirectional", no_argument, NULL, 'B'},
+        {"coordinates", required_argument, NULL, 'c'},
+        {"heuristic", required_argument, NULL, 'A'},
+        {"landmarks", required_argument, NULL, 'L'},
+        {"landmark-file", required_argument, NULL, 'l'},
+        {"contract", no_argument, NULL, 'C'},
+        {"hierarchy-file", required_argument, NULL, 'K'},
+        {"predecessors", no_argument, NULL, 'P'},
+        {"updates", required_argument, NULL, 'U'},
+        {"reorder", required_argument, NULL, 'r'},
+        {"threads", required_argument, NULL, 't'},
+        {"affinity", required_argument, NULL, 'a'},
+        {"huge-pages", no_argument, NULL, 'H'},
+        {"prefetch", required_argument, NULL, 'F'},
+        {"simd", required_argument, NULL, 'x'},
+        {"engine", required_argument, NULL, 'e'},
+        {"delta", required_argument, NULL, 'd'},
+        {"validate", no_argument, NULL, 'V'},
+        {"batch", required_argument, NULL, 'b'},
+        {"concurrent", required_argument, NULL, 'j'},
+        {"output-dir", required_argument, NULL, 'o'},
+        {"output-format", required_argument, NULL, 'O'},
+        {"stats", required_argument, NULL, 'S'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:g:s:DIT:Bc:A:L:l:CK:PU:r:t:a:HF:x:e:d:Vb:j:o:O:S:", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                if (!parse_graph_format(optarg, &loadOptions.format)) {
+                    cerr << "Unknown graph format " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 'g':
+                generatorSpec = optarg;
+                break;
+            case 's':
+                loadOptions.source = atoll(optarg);
+                break;
+            case 'D':
+                loadOptions.directed = true;
+                break;
+            case 'I':
+                incoming = true;
+                break;
+            case 'T':
+                target = atoll(optarg);
+                break;
+            case 'B':
+                bidirectional = true;
+                break;
+            case 'c':
+                coordinatesFile = optarg;
+                break;
+            case 'A':
+                if (!parse_heuristic(optarg, &heuristicKind)) {
+                    cerr << "Unknown heuristic " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 'L':
+                numOfLandmarks = atoi(optarg);
+                if (numOfLandmarks < 1) {
+                    cerr << "The number of landmarks must be positive" << endl;
+                    exit(1);
+                }
+                break;
+            case 'l':
+                landmarkFile = optarg;
+                break;
+            case 'C':
+                contract = true;
+                break;
+            case 'K':
+                hierarchyFile = optarg;
+                break;
+            case 'P':
+                predecessors = true;
+                break;
+            case 'U':
+                updatesFile = optarg;
+                break;
+            case 'r':
+                if (!parse_vertex_order(optarg, &order)) {
+                    cerr << "Unknown vertex order " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 't':
+                numOfThreads = atoi(optarg);
+                if (numOfThreads < 1) {
+                    cerr << "The number of threads must be positive" << endl;
+                    exit(1);
+                }
+                break;
+            case 'a':
+                if (!placement.parse(optarg)) {
+                    cerr << "Unknown affinity policy " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 'H':
+                hugePages = true;
+                break;
+            case 'F':
+                DijkstraSolver::prefetchDistance = atoi(optarg);
+                if (DijkstraSolver::prefetchDistance < 0) {
+                    cerr << "The prefetch distance cannot be negative" << endl;
+                    exit(1);
+                }
+                break;
+            case 'x':
+                if (!parse_relax_kernel(optarg, &DijkstraSolver::relaxKernel)) {
+                    cerr << "Unknown relax kernel " << optarg << endl;
+                    exit(1);
+                }
+                if (!relax_kernel_supported(DijkstraSolver::relaxKernel)) {
+                    cerr << "This CPU or build has no " << optarg << " relax kernel" << endl;
+                    exit(1);
+                }
+                break;
+            case 'e':
+                deltaStepping = string(optarg) == "delta";
+                sequential = string(optarg) == "sequential";
+                if (!deltaStepping && !sequential && string(optarg) != "multiqueues") {
+                    cerr << "Unknown engine " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 'd':
+                delta = atoll(optarg);
+                break;
+            case 'V':
+                validate = true;
+                break;
+            case 'b':
+                batchFile = optarg;
+                break;
+            case 'j':
+                concurrent = atoi(optarg);
+                break;
+            case 'o':
+                outDir = optarg;
+                break;
+            case 'S':
+                if (!parse_stats_format(optarg, &stats)) {
+                    cerr << "Unknown stats format " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            case 'O':
+                if (!parse_output_format(optarg, &output.format)) {
+                    cerr << "Unknown output format " << optarg << endl;
+                    exit(1);
+                }
+                break;
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+    // a generated graph takes the place of the graph file
+    bool generate = !generatorSpec.empty();
+    if (argc - optind < (generate ? 1 : 2)) {
+        usage(argv[0]);
         exit(1);
     }
 
-    int tuning_parameter = atoi(argv[2]);
+    bool multiqueues = !deltaStepping && !sequential;
+    if (!multiqueues && (target >= 0 || bidirectional || !batchFile.empty())) {
+        cerr << "Point-to-point and batch queries need the multiqueues engine" << endl;
+        exit(1);
+    }
+    if (bidirectional && target < 0 && batchFile.empty()) {
+        cerr << "A bidirectional search needs a target" << endl;
+        exit(1);
+    }
+    if (coordinatesFile.empty()) {
+        heuristicKind = HEURISTIC_NONE;
+    }
+    if (numOfLandmarks || !landmarkFile.empty()) {
+        if (heuristicKind != HEURISTIC_NONE) {
+            cerr << "Use either coordinates or landmarks" << endl;
+            exit(1);
+        }
+        heuristicKind = HEURISTIC_LANDMARKS;
+    }
+    if (heuristicKind != HEURISTIC_NONE && (bidirectional || !multiqueues)) {
+        cerr << "A* runs as a one-sided multiqueues search" << endl;
+        exit(1);
+    }
+    bool useHierarchy = contract || !hierarchyFile.empty();
+    if (useHierarchy && (heuristicKind != HEURISTIC_NONE || bidirectional || !multiqueues)) {
+        cerr << "A contraction hierarchy answers point-to-point queries on its own" << endl;
+        exit(1);
+    }
+    if (predecessors && (useHierarchy || !multiqueues || validate)) {
+        cerr << "Predecessors are recorded by the multiqueues engine only" << endl;
+        exit(1);
+    }
+    if (!updatesFile.empty() && (target >= 0 || !batchFile.empty() || useHierarchy || !multiqueues ||
+                                 heuristicKind != HEURISTIC_NONE)) {
+        cerr << "Updates repair a full multiqueues search from the source" << endl;
+        exit(1);
+    }
+    if (validate && (target >= 0 || !batchFile.empty() || useHierarchy || !multiqueues || !updatesFile.empty() ||
+                     heuristicKind != HEURISTIC_NONE)) {
+        cerr << "Validation checks a full multiqueues search from the source" << endl;
+        exit(1);
+    }
+    if (stats != STATS_NONE && (useHierarchy || !multiqueues)) {
+        cerr << "Work counters are kept by the multiqueues engine only" << endl;
+        exit(1);
+    }
+
+    string pathToFile = generate ? generatorSpec : argv[optind];
+
+    int tuning_parameter = atoi(argv[optind + (generate ? 0 : 1)]);
     if (!tuning_parameter) {
         cerr << "A tuning parameter must be provided";
         exit(1);
     }
 
+    loadOptions.numOfThreads = numOfThreads;
+    // repairs look for in-neighbors
+    loadOptions.reverse = bidirectional || incoming || !updatesFile.empty();
+    output.numOfThreads = numOfThreads;
     Graph *G = new Graph();
 
-    string line;
-    string firstLine;
-    int source_index;
-    char* n;
-
-    getline(f,firstLine); //get the first line of # nodes, # edges and source node
-
-    // get source vertex
-    char str [line.size() + 1];
-    strncpy(str, firstLine.c_str(), firstLine.size() + 1);
-    char *token = strtok(str, " ");
-    int num_vertices = strtol(token, &n, 0);
-    token = strtok(NULL, " ");
-    int num_edges = strtol(token, &n, 0);
-    token = strtok(NULL, " ");
-    source_index = strtol(token, &n, 0);
-    G->source = source_index;
-
-    G->vertices.resize(num_vertices);
-    for (int i = 0; i < num_vertices; i++) {
-        G->vertices[i] = new Vertex();
+    if (generate) {
+        GeneratorOptions generatorOptions;
+        if (!parse_generator_spec(generatorSpec, &generatorOptions)) {
+            exit(1);
+        }
+        generatorOptions.numOfThreads = numOfThreads;
+        generatorOptions.directed = loadOptions.directed;
+        generatorOptions.reverse = loadOptions.reverse;
+        generatorOptions.source = loadOptions.source;
+        if (!generate_graph(generatorOptions, G)) {
+            exit(1);
+        }
+    } else if (!load_graph(pathToFile, G, loadOptions)) {
+        cerr << "Unable to load graph " + pathToFile;
+        exit(1);
+    }
+    if (useHierarchy && G->directed) {
+        cerr << "Contraction hierarchies are built for undirected graphs only" << endl;
+        exit(1);
+    }
+    if (incoming && G->directed) {
+        if (!G->reverse) {
+            G->build_reverse(numOfThreads);
+            G->reverse->remove_parallel_edges(numOfThreads);
+        }
+        G->swap_reverse();
     }
 
-    while (getline(f,line)) {
-        Vertex *source = nullptr;
-        Vertex *v1 = nullptr;
-        Vertex *v2 = nullptr;
-        int v1_index;
-        int v2_index;
-        int weight;
-        char *p;
-        char *q;
-        char *m;
-
-        // copy line
-        char str[line.size() + 1];
-        strncpy(str, line.c_str(), line.size() + 1);
-
-        // Returns first token
-        token = strtok(str, " ");
-
-        // get vertex v1 index
-        v1_index = strtol(token, &p, 0);
-
-        // get vertex v2 index
-        v2_index = strtol(strtok(NULL, " "), &q, 0);
-
-        v1 = G->vertices[v1_index];
-        v2 = G->vertices[v2_index];
-        // get edge weight
-        weight = strtol(strtok(NULL, " "), &m, 0);
-
-        v1->index = v1_index;
-        v2->index = v2_index;
-        //Weight
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (order != ORDER_NONE) {
+        reorder_graph(G, order, numOfThreads);
+        cout << "reordered in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+        start = chrono::steady_clock::now();
+    }
 
-        v1->neighbors.push_back(make_pair(v2, weight));
-        v2->neighbors.push_back(make_pair(v1, weight));
+    ContractionHierarchy ch;
+    if (useHierarchy) {
+        if (contract) {
+            ch.build(G, numOfThreads);
+            if (!hierarchyFile.empty() && !ch.save(hierarchyFile, G)) {
+                cerr << "Unable to write hierarchy file " + hierarchyFile;
+                exit(1);
+            }
+        } else if (!ch.load(hierarchyFile, G)) {
+            cerr << "Unable to load hierarchy file " + hierarchyFile;
+            exit(1);
+        }
+        if (target < 0 && batchFile.empty()) {
+            delete G;
+            return 0;
+        }
+        start = chrono::steady_clock::now();
+    }
 
+    // coordinates are read by file id, so they follow any relabeling
+    Heuristic heuristic;
+    LandmarkTable landmarks;
+    if (heuristicKind == HEURISTIC_LANDMARKS) {
+        if (numOfLandmarks) {
+            landmarks.select(G, numOfLandmarks, tuning_parameter, numOfThreads, concurrent, hugePages, &placement);
+            cout << "selected " << landmarks.k << " landmarks in "
+                 << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+            if (!landmarkFile.empty() && !landmarks.save(landmarkFile, G)) {
+                cerr << "Unable to write landmark file " + landmarkFile;
+                exit(1);
+            }
+        } else if (!landmarks.load(landmarkFile, G)) {
+            cerr << "Unable to load landmark file " + landmarkFile;
+            exit(1);
+        }
+        if (target < 0 && batchFile.empty()) {
+            delete G;
+            return 0;
+        }
+        heuristic.use_landmarks(&landmarks);
+        start = chrono::steady_clock::now();
+    } else if (heuristicKind != HEURISTIC_NONE) {
+        if (!heuristic.load(coordinatesFile, G, heuristicKind, numOfThreads)) {
+            cerr << "Unable to load coordinates " + coordinatesFile;
+            exit(1);
+        }
+        start = chrono::steady_clock::now();
     }
+    const Heuristic *h = heuristicKind != HEURISTIC_NONE ? &heuristic : NULL;
+    bool valid = true;
 
-    f.close();
-    dijkstra_shortest_path(G, tuning_parameter, NUM_OF_THREADS);
+    if (!batchFile.empty()) {
+        ifstream f(batchFile.c_str());
+        if (!f) {
+            cerr << "Unable to open file " + batchFile;
+            exit(1);
+        }
+        vector<Query> queries;
+        string line;
+        while (getline(f, line)) {
+            istringstream fields(line);
+            Query query;
+            if (!(fields >> query.source)) {
+                continue;
+            }
+            if (!(fields >> query.target)) {
+                query.target = NO_TARGET;
+            }
+            queries.push_back(query);
+        }
+        if (useHierarchy) {
+            hierarchy_queries(G, &ch, queries, numOfThreads, outDir);
+        } else {
+            batch_shortest_paths(G, queries, tuning_parameter, numOfThreads, concurrent, bidirectional, h, hugePages,
+                                 &placement, outDir, predecessors, output, stats);
+        }
+    } else if (target >= 0) {
+        vertex_t t;
+        if (!G->from_file_id(target, &t)) {
+            cerr << "Target " << target << " is not a vertex of the graph" << endl;
+            exit(1);
+        }
+        if (useHierarchy) {
+            HierarchyQuery query(&ch);
+            dist_t distance = query.distance(G->source, t);
+            if (distance == DIST_INF) {
+                cout << "target unreachable" << endl;
+            } else {
+                cout << "distance " << distance << endl;
+            }
+        } else {
+            dijkstra_point_to_point(G, t, tuning_parameter, numOfThreads, bidirectional, h, hugePages, &placement,
+                                    predecessors, stats);
+        }
+    } else if (!updatesFile.empty()) {
+        ifstream f(updatesFile.c_str());
+        if (!f) {
+            cerr << "Unable to open file " + updatesFile;
+            exit(1);
+        }
+        // ids in file numbering; -I searched the reverse graph, where u -> v is v -> u
+        vector< vector<Edge> > batches(1);
+        string line;
+        for (size_t number = 1; getline(f, line); number++) {
+            istringstream fields(line);
+            long long u, v, w;
+            if (!(fields >> u >> v >> w)) {
+                if (line.find_first_not_of(" \t\r") != string::npos) {
+                    cerr << updatesFile << ":" << number << ": expected \"u v w\", got \"" << line << "\"" << endl;
+                    exit(1);
+                }
+                if (!batches.back().empty()) {
+                    batches.push_back(vector<Edge>());
+                }
+                continue;
+            }
+            Edge edge;
+            if (!G->from_file_id(u, &edge.u) || !G->from_file_id(v, &edge.v)) {
+                cerr << "Update " << line << " is not an edge between vertices of the graph" << endl;
+                exit(1);
+            }
+            // -1 deletes; from DELETED_WEIGHT up a weight would not fit, or would read as a deletion
+            if (w < -1 || w >= DELETED_WEIGHT) {
+                cerr << updatesFile << ":" << number << ": weight " << w << " is not -1 or in [0, "
+                     << DELETED_WEIGHT - 1 << "]" << endl;
+                exit(1);
+            }
+            if (incoming && G->directed) {
+                swap(edge.u, edge.v);
+            }
+            edge.weight = w < 0 ? DELETED_WEIGHT : (int) w;
+            batches.back().push_back(edge);
+        }
+        if (batches.back().empty()) {
+            batches.pop_back();
+        }
+        dijkstra_with_updates(G, batches, tuning_parameter, numOfThreads, hugePages, &placement, output, stats);
+    } else if (validate) {
+        valid = validate_shortest_path(G, tuning_parameter, numOfThreads, hugePages, &placement, stats);
+    } else if (deltaStepping) {
+        delta_stepping_shortest_path(G, delta, numOfThreads, &placement, output);
+    } else if (sequential) {
+        sequential_shortest_path(G, output);
+    } else {
+        dijkstra_shortest_path(G, tuning_parameter, numOfThreads, hugePages, &placement, predecessors, output,
+                               stats);
+    }
+    cout << "sssp in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
     delete G;
+    return valid ? 0 : 1;
 
-}
\ No newline at end of file
+}